@@ -0,0 +1,438 @@
+/**
+ * \file benchmark.cpp
+ *
+ *
+ * \brief Micro-benchmarks for all DSP components of the VectorSynth.
+ *
+ * Measures the time per sample of WaveGen, Envelope, MoogLadderFilter and Key
+ * and of the complete Midi2KeyHandler at full polyphony for several buffer sizes.
+ * Every result is printed as one line of CSV (default) or JSON, so builds can be
+ * compared on the RPi3 and on x86.
+ *
+ * Usage: benchmark [-f csv|json] [-t seconds] [-r samplerate]
+ *
+ * Columns:
+ * - component, variant: what was measured
+ * - buffer: samples per call
+ * - voices: number of voices rendered in parallel
+ * - ns_per_sample: nanoseconds per sample and voice
+ * - voices_per_core: how many voices one core could render in realtime at this cost
+ * - max_error: largest error against the reference implementation, only for approximations (Saturation)
+ *   and for the four-voice ladder (renderBlock4 against the scalar ladder on the same input and G)
+ *
+ * \author $Author: Corvin Jaedicke & Alberto Monciero $
+ *
+ * \version $Revision: 1.5 $
+ *
+ * \date $Date: 2017/29/04 21:14:27 $
+ *
+ * Contact: c.jaedicke@math.tu-berlin.de
+ *
+ */
+
+#include <iostream>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "../src/simd.h"
+#include "../src/waveGen.h"
+#include "../src/envelope.h"
+#include "../src/moogLadderFilter.h"
+#include "../src/saturation.h"
+#include "../src/key.h"
+#include "../src/midi2KeyHandler.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace {
+
+bool json = false; ///< Output format
+double minSeconds = 0.2; ///< Minimum measuring time per benchmark
+int sampleRate = 48000; ///< Sample rate of all components
+volatile float sink; ///< Keeps the compiler from removing the work
+
+#if defined(VECTORSYNTH_NEON)
+const char * simdName = "neon";
+#elif defined(VECTORSYNTH_SSE)
+const char * simdName = "sse";
+#else
+const char * simdName = "scalar";
+#endif
+
+/// Prints one result line, maxError < 0 if there is no reference to compare with.
+void report(const std::string& component, const std::string& variant, int buffer, int voices, double nsPerSample, double maxError = -1.0) {
+    double voicesPerCore = 1e9 / sampleRate / nsPerSample;
+    if(json) {
+        cout << "{\"component\":\"" << component << "\",\"variant\":\"" << variant
+             << "\",\"simd\":\"" << simdName << "\",\"buffer\":" << buffer << ",\"voices\":" << voices
+             << ",\"ns_per_sample\":" << nsPerSample << ",\"voices_per_core\":" << voicesPerCore;
+        if(maxError >= 0.0)
+            cout << ",\"max_error\":" << maxError;
+        cout << "}" << endl;
+    } else {
+        cout << component << "," << variant << "," << simdName << "," << buffer << "," << voices << ","
+             << nsPerSample << "," << voicesPerCore << ",";
+        if(maxError >= 0.0)
+            cout << maxError;
+        cout << endl;
+    }
+}
+
+/**
+ * \brief Runs a benchmark until minSeconds have passed.
+ * \param run Renders samplesPerRun samples (for all voices)
+ * \param samplesPerRun Samples per voice rendered by one call of run
+ * \param voices Number of voices rendered by one call of run
+ * \return Nanoseconds per sample and voice
+ */
+template <typename F>
+double measure(F run, long samplesPerRun, int voices) {
+    // warm up caches and branch predictors
+    for(int i = 0; i < 10; i++)
+        run();
+    long runs = 0;
+    double elapsed = 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while(elapsed < minSeconds) {
+        for(int i = 0; i < 16; i++)
+            run();
+        runs += 16;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return elapsed * 1e9 / ((double) runs * samplesPerRun * voices);
+}
+
+midiMessage message(int byte1, int byte2, int byte3) {
+    midiMessage m;
+    m.byte1 = byte1;
+    m.byte2 = byte2;
+    m.byte3 = byte3;
+    m.hasBeenProcessed = true;
+    m.time = 0;
+    return m;
+}
+
+void benchmarkWaveGen() {
+    const char * names[] = {"sine", "square", "triangle", "sawtooth", "custom"};
+    TYPE types[] = {SINUS, SQUARE, TRIANGLE, SAWTOOTH, CUSTOM_WAVE};
+    const int blockSize = Key::maxBlockSize;
+    float buffer[blockSize];
+    for(int t = 0; t < 5; t++) {
+        WaveGen osc(440.0, 1.0, 0.0, sampleRate, types[t]);
+        report("WaveGen", std::string("getNextAntiAliasedSample_") + names[t], 1, 1,
+               measure([&]() {
+                   float sum = 0.0;
+                   for(int i = 0; i < blockSize; i++)
+                       sum += osc.getNextAntiAliasedSample();
+                   sink = sum;
+               }, blockSize, 1));
+        report("WaveGen", std::string("renderBlock_") + names[t], blockSize, 1,
+               measure([&]() {
+                   osc.renderBlock(buffer, blockSize);
+                   sink = buffer[blockSize - 1];
+               }, blockSize, 1));
+    }
+}
+
+void benchmarkEnvelope() {
+    const int blockSize = Key::maxBlockSize;
+    float buffer[blockSize];
+    Envelope envelope;
+    // long stages, so the envelope keeps moving
+    envelope.setAttack(10.0);
+    envelope.setDecay(10.0);
+    envelope.setRelease(10.0);
+    envelope.enterStage(Envelope::ENVELOPE_STAGE_ATTACK);
+    report("Envelope", "getNextSample", 1, 1,
+           measure([&]() {
+               for(int i = 0; i < blockSize; i++)
+                   envelope.getNextSample(&buffer[i]);
+               sink = buffer[blockSize - 1];
+           }, blockSize, 1));
+    envelope.enterStage(Envelope::ENVELOPE_STAGE_ATTACK);
+    report("Envelope", "renderBlock", blockSize, 1,
+           measure([&]() {
+               envelope.renderBlock(buffer, blockSize);
+               sink = buffer[blockSize - 1];
+           }, blockSize, 1));
+
+    // four envelopes in structure-of-arrays form, as rendered out of the VoicePool
+    Envelope envelopes[4];
+    Envelope * e[4];
+    float buffers[4][blockSize];
+    float * b[4];
+    float level[4], multiplier[4];
+    int remaining[4];
+    for(int v = 0; v < 4; v++) {
+        envelopes[v].setAttack(10.0 + v);
+        envelopes[v].setDecay(10.0);
+        envelopes[v].setRelease(10.0);
+        envelopes[v].enterStage(Envelope::ENVELOPE_STAGE_ATTACK);
+        envelopes[v].getRenderState(level[v], multiplier[v], remaining[v]);
+        e[v] = &envelopes[v];
+        b[v] = buffers[v];
+    }
+    report("Envelope", "renderBlock4", blockSize, 4,
+           measure([&]() {
+               Envelope::renderBlock4(e, level, multiplier, remaining, b, blockSize);
+               sink = buffers[3][blockSize - 1];
+           }, blockSize, 4));
+}
+
+/**
+ * \brief Largest difference between MoogLadderFilter::renderBlock4 and the scalar ladder.
+ * \param mode Saturation of both paths
+ * \param factor Oversampling of both paths
+ * \param resonance K of all four voices
+ * \return Largest absolute difference of one second of noise with modulated cut-off
+ *
+ * The scalar reference runs doFilter() sample by sample after setG(), or
+ * renderBlock() with the same G when oversampled (doFilter() has no G input there).
+ */
+double ladderError(Saturation::Mode mode, int factor, float resonance) {
+    const int blockSize = Key::maxBlockSize;
+    MoogLadderFilter vector[4], scalar[4];
+    MoogLadderFilter * f[4];
+    float buffers[4][blockSize], reference[4][blockSize], g[4][blockSize];
+    float * b[4];
+    const float * gp[4];
+    for(int v = 0; v < 4; v++) {
+        MoogLadderFilter * pair[2] = {&vector[v], &scalar[v]};
+        for(int p = 0; p < 2; p++) {
+            pair[p]->setSampleRate(sampleRate);
+            pair[p]->setResonance(resonance);
+            pair[p]->setSaturation(mode);
+            pair[p]->setOversampling(factor);
+        }
+        f[v] = &vector[v];
+        b[v] = buffers[v];
+        gp[v] = g[v];
+    }
+    double maxError = 0.0;
+    for(int block = 0; block < sampleRate / blockSize; block++) {
+        for(int v = 0; v < 4; v++) {
+            for(int i = 0; i < blockSize; i++) {
+                buffers[v][i] = reference[v][i] = (float) rand() / RAND_MAX - 0.5;
+                // cut-off sweeps 100 Hz..10 kHz and back, every voice with its own rate
+                float sweep = 0.5 - 0.5 * cos(2.0 * M_PI * (block * blockSize + i) * (v + 1) / sampleRate);
+                g[v][i] = vector[v].lookUpG(100.0 * pow(100.0, sweep));
+            }
+            if(factor == 1) {
+                for(int i = 0; i < blockSize; i++) {
+                    scalar[v].setG(g[v][i]);
+                    scalar[v].doFilter(&reference[v][i]);
+                }
+            } else {
+                scalar[v].renderBlock(reference[v], g[v], blockSize);
+            }
+        }
+        MoogLadderFilter::renderBlock4(f, b, gp, blockSize);
+        for(int v = 0; v < 4; v++)
+            for(int i = 0; i < blockSize; i++)
+                maxError = std::max(maxError, (double) fabs(buffers[v][i] - reference[v][i]));
+    }
+    return maxError;
+}
+
+void benchmarkFilter() {
+    const int blockSize = Key::maxBlockSize;
+    float input[4][blockSize];
+    float buffers[4][blockSize];
+    float g[4][blockSize];
+    MoogLadderFilter filters[4];
+    for(int v = 0; v < 4; v++) {
+        filters[v].setSampleRate(sampleRate);
+        filters[v].setResonance(2.0);
+        for(int i = 0; i < blockSize; i++) {
+            input[v][i] = (float) rand() / RAND_MAX - 0.5;
+            // modulated cut-off, like a voice with filter envelope
+            g[v][i] = filters[v].lookUpG(1000.0 + 20.0 * i + 100.0 * v);
+        }
+    }
+    report("MoogLadderFilter", "doFilter_fixed_cutoff", 1, 1,
+           measure([&]() {
+               for(int i = 0; i < blockSize; i++) {
+                   buffers[0][i] = input[0][i];
+                   filters[0].doFilter(&buffers[0][i]);
+               }
+               sink = buffers[0][blockSize - 1];
+           }, blockSize, 1));
+    report("MoogLadderFilter", "doFilter_setCutOff_per_sample", 1, 1,
+           measure([&]() {
+               for(int i = 0; i < blockSize; i++) {
+                   buffers[0][i] = input[0][i];
+                   filters[0].setCutOff(1000.0 + 20.0 * i);
+                   filters[0].doFilter(&buffers[0][i]);
+               }
+               sink = buffers[0][blockSize - 1];
+           }, blockSize, 1));
+    report("MoogLadderFilter", "renderBlock_modulated", blockSize, 1,
+           measure([&]() {
+               for(int i = 0; i < blockSize; i++)
+                   buffers[0][i] = input[0][i];
+               filters[0].renderBlock(buffers[0], g[0], blockSize);
+               sink = buffers[0][blockSize - 1];
+           }, blockSize, 1));
+    MoogLadderFilter * f[4] = {&filters[0], &filters[1], &filters[2], &filters[3]};
+    float * b[4] = {buffers[0], buffers[1], buffers[2], buffers[3]};
+    const float * gp[4] = {g[0], g[1], g[2], g[3]};
+    for(int mode = 0; mode < Saturation::numModes; mode++) {
+        for(int v = 0; v < 4; v++)
+            filters[v].setSaturation((Saturation::Mode) mode);
+        report("MoogLadderFilter", std::string("renderBlock4_modulated_") + Saturation::name((Saturation::Mode) mode), blockSize, 4,
+               measure([&]() {
+                   for(int v = 0; v < 4; v++)
+                       for(int i = 0; i < blockSize; i++)
+                           buffers[v][i] = input[v][i];
+                   MoogLadderFilter::renderBlock4(f, b, gp, blockSize);
+                   sink = buffers[3][blockSize - 1];
+               }, blockSize, 4),
+               ladderError((Saturation::Mode) mode, 1, 2.0));
+    }
+    // oversampled ladder, G belongs to the higher rate
+    for(int factor = 2; factor <= Oversampler::maxFactor; factor *= 2) {
+        for(int v = 0; v < 4; v++) {
+            filters[v].setSaturation(Saturation::SATURATION_PADE);
+            filters[v].setOversampling(factor);
+            for(int i = 0; i < blockSize; i++)
+                g[v][i] = filters[v].lookUpG(1000.0 + 20.0 * i + 100.0 * v);
+        }
+        report("MoogLadderFilter", "renderBlock_modulated_os" + std::to_string(factor), blockSize, 1,
+               measure([&]() {
+                   for(int i = 0; i < blockSize; i++)
+                       buffers[0][i] = input[0][i];
+                   filters[0].renderBlock(buffers[0], g[0], blockSize);
+                   sink = buffers[0][blockSize - 1];
+               }, blockSize, 1));
+        report("MoogLadderFilter", "renderBlock4_modulated_pade_os" + std::to_string(factor), blockSize, 4,
+               measure([&]() {
+                   for(int v = 0; v < 4; v++)
+                       for(int i = 0; i < blockSize; i++)
+                           buffers[v][i] = input[v][i];
+                   MoogLadderFilter::renderBlock4(f, b, gp, blockSize);
+                   sink = buffers[3][blockSize - 1];
+               }, blockSize, 4),
+               ladderError(Saturation::SATURATION_PADE, factor, 2.0));
+    }
+}
+
+/// Runs the tanh of one saturation mode on four lanes, with the mode fixed at compile time like in the ladder.
+template <Saturation::Mode mode>
+void benchmarkSaturation(const float * input, int blockSize) {
+    float buffer[Key::maxBlockSize];
+    report("Saturation", std::string("process4_") + Saturation::name(mode), blockSize, 1,
+           measure([&]() {
+               for(int i = 0; i < blockSize; i += 4)
+                   simd::store(&buffer[i], Saturation::process4<mode>(simd::load(&input[i])));
+               sink = buffer[blockSize - 1];
+           }, blockSize, 1),
+           Saturation::maxError(mode));
+}
+
+void benchmarkSaturation() {
+    const int blockSize = Key::maxBlockSize;
+    float input[blockSize];
+    for(int i = 0; i < blockSize; i++)
+        input[i] = 6.0f * rand() / RAND_MAX - 3.0f;
+    benchmarkSaturation<Saturation::SATURATION_LIBM>(input, blockSize);
+    benchmarkSaturation<Saturation::SATURATION_TABLE>(input, blockSize);
+    benchmarkSaturation<Saturation::SATURATION_PADE>(input, blockSize);
+    benchmarkSaturation<Saturation::SATURATION_BYPASS>(input, blockSize);
+}
+
+void benchmarkKey() {
+    const int blockSize = Key::maxBlockSize;
+    float buffer[blockSize];
+    float lfo[blockSize];
+    for(int i = 0; i < blockSize; i++)
+        lfo[i] = 0.0;
+    Key key;
+    key.setSampleRate(sampleRate);
+    key.setSustain(1.0);
+    key.noteOn(57, 100.0, 220.0);
+    report("Key", "renderBlock", blockSize, 1,
+           measure([&]() {
+               for(int i = 0; i < blockSize; i++)
+                   buffer[i] = 0.0;
+               key.renderBlock(buffer, lfo, blockSize);
+               sink = buffer[blockSize - 1];
+           }, blockSize, 1));
+}
+
+void benchmarkHandler(int numThreads) {
+    const int bufferSizes[] = {16, 64, 256, 1024};
+    const int voices = 24;
+    for(int s = 0; s < 4; s++) {
+        int bufferSize = bufferSizes[s];
+        std::vector<float> buffer(bufferSize);
+        Midi2KeyHandler handler(sampleRate, numThreads);
+        // full sustain, so all voices keep playing
+        handler.mapMidi(message(176, 72, 127));
+        handler.mapMidi(message(176, 76, 100));
+        for(int v = 0; v < voices; v++)
+            handler.mapMidi(message(144, 36 + v * 2, 100));
+        report("Midi2KeyHandler", "getNextSampleBuffer_threads" + std::to_string(handler.getNumThreads()), bufferSize, voices,
+               measure([&]() {
+                   handler.getNextSampleBuffer(&buffer[0], bufferSize);
+                   sink = buffer[bufferSize - 1];
+               }, bufferSize, voices));
+        // fast controller sweep: cut-off, resonance and wave mix change every buffer
+        int step = 0;
+        report("Midi2KeyHandler", "getNextSampleBuffer_cc_sweep_threads" + std::to_string(handler.getNumThreads()), bufferSize, voices,
+               measure([&]() {
+                   midiMessage sweep[3] = {message(176, 76, step % 128), message(176, 77, (step / 2) % 128), message(176, 1, (step * 3) % 128)};
+                   step++;
+                   handler.getNextSampleBuffer(&buffer[0], bufferSize, sweep, 3);
+                   sink = buffer[bufferSize - 1];
+               }, bufferSize, voices));
+    }
+}
+
+void usage() {
+    cerr << "usage: benchmark [-f csv|json] [-t seconds] [-r samplerate]" << endl;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    while((opt = getopt(argc, argv, "f:t:r:h")) != -1) {
+        switch(opt) {
+            case 'f':
+                if(std::string(optarg) == "json") {
+                    json = true;
+                } else if(std::string(optarg) == "csv") {
+                    json = false;
+                } else {
+                    usage();
+                    return 1;
+                }
+                break;
+            case 't': minSeconds = atof(optarg); break;
+            case 'r': sampleRate = atoi(optarg); break;
+            default: usage(); return 1;
+        }
+    }
+    if(minSeconds <= 0 || sampleRate <= 0) {
+        usage();
+        return 1;
+    }
+
+    if(!json)
+        cout << "component,variant,simd,buffer,voices,ns_per_sample,voices_per_core,max_error" << endl;
+    benchmarkWaveGen();
+    benchmarkEnvelope();
+    benchmarkSaturation();
+    benchmarkFilter();
+    benchmarkKey();
+    for(int numThreads = 1; numThreads <= WorkerPool::maxThreads; numThreads++)
+        benchmarkHandler(numThreads);
+    return 0;
+}
@@ -0,0 +1,8 @@
+#!/bin/sh
+
+## enable NEON on the RPi3 with a 32 bit image, AArch64 always has it
+case $(uname -m) in
+    armv7l) ARCH_FLAGS="-mcpu=cortex-a53 -mfpu=neon-fp-armv8 -mfloat-abi=hard" ;;
+esac
+
+g++ -O3 -std=c++11 -pthread $ARCH_FLAGS benchmark.cpp ../src/filter.cpp ../src/moogLadderFilter.cpp ../src/saturation.cpp ../src/oversampler.cpp ../src/parameterSmoother.cpp ../src/patch.cpp ../src/waveGen.cpp ../src/waveTables.cpp ../src/key.cpp ../src/envelope.cpp ../src/midi2KeyHandler.cpp ../src/workerPool.cpp ../src/voicePool.cpp ../src/realtimeCheck.cpp -o benchmark
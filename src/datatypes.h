@@ -34,3 +34,13 @@ typedef struct  {
 
 }ctlMessage;
 
+
+typedef struct  {
+    int byte1		  	  = -1;    /// @var byte1 Status byte
+    int byte2             = -1;
+    double byte3          = -1;
+    bool hasBeenProcessed = false;
+    unsigned int time     = 0; ///< Frame offset inside the current period
+
+}midiMessage;
+
@@ -1,4 +1,5 @@
 #include "envelope.h"
+#include "simd.h"
 
 double Envelope::getNextSample() {
     if (currentStage != ENVELOPE_STAGE_OFF &&
@@ -30,10 +31,164 @@ void Envelope::getNextSample(float * pSample) {
     *pSample = currentLevel;
 }
 
-void Envelope::calculateMultiplier(double startLevel,
-                                            double endLevel,
+void Envelope::renderBlock(float * pBuffer, int nFrames) {
+    int i = 0;
+    while (i < nFrames) {
+        if (currentStage != ENVELOPE_STAGE_OFF &&
+            currentStage != ENVELOPE_STAGE_SUSTAIN &&
+            currentSampleIndex == nextStageSampleIndex) {
+            EnvelopeStage newStage = static_cast<EnvelopeStage>(
+                (currentStage + 1) % kNumEnvelopeStages
+            );
+            enterStage(newStage);
+        }
+        if (currentStage == ENVELOPE_STAGE_OFF ||
+            currentStage == ENVELOPE_STAGE_SUSTAIN) {
+            // constant until the next note event
+            float level = currentLevel;
+            for (; i < nFrames; i++) {
+                pBuffer[i] = level;
+            }
+            return;
+        }
+        int run = nFrames - i;
+        // a stage of zero length is past its end at once and never ends, like in getNextSample()
+        if (currentSampleIndex < nextStageSampleIndex &&
+            nextStageSampleIndex - currentSampleIndex < (unsigned long long) run) {
+            run = nextStageSampleIndex - currentSampleIndex;
+        }
+        renderSegment(&pBuffer[i], run);
+        currentSampleIndex += run;
+        i += run;
+    }
+}
+
+void Envelope::renderSegment(float * pBuffer, int nFrames) {
+    using namespace simd;
+    // four consecutive samples per vector: level * m, level * m^2, level * m^3, level * m^4
+    double m2 = multiplier * multiplier;
+    double m4 = m2 * m2;
+    float start[4] = {(float) (currentLevel * multiplier), (float) (currentLevel * m2),
+                      (float) (currentLevel * m2 * multiplier), (float) (currentLevel * m4)};
+    float4 level = load(start);
+    const float4 step = set1(m4);
+    int i = 0;
+    for (; i + 4 <= nFrames; i += 4) {
+        store(&pBuffer[i], level);
+        level = mul(level, step);
+    }
+    float rest[4];
+    store(rest, level);
+    for (int j = 0; i < nFrames; i++, j++) {
+        pBuffer[i] = rest[j];
+    }
+    currentLevel *= pow(multiplier, nFrames);
+}
+
+void Envelope::getRenderState(float & level, float & multiplier, int & remaining) const {
+    level = currentLevel;
+    multiplier = this->multiplier;
+    if (currentStage == ENVELOPE_STAGE_OFF ||
+        currentStage == ENVELOPE_STAGE_SUSTAIN ||
+        currentSampleIndex > nextStageSampleIndex) {
+        remaining = noStageChange;
+    } else {
+        unsigned long long samples = nextStageSampleIndex - currentSampleIndex;
+        remaining = samples < (unsigned long long) noStageChange ? (int) samples : noStageChange - 1;
+    }
+}
+
+void Envelope::setRenderState(float level, float multiplier, int remaining) {
+    currentLevel = level;
+    this->multiplier = multiplier;
+    if (remaining != noStageChange) {
+        currentSampleIndex = nextStageSampleIndex - remaining;
+    } else if (currentStage != ENVELOPE_STAGE_OFF &&
+               currentStage != ENVELOPE_STAGE_SUSTAIN &&
+               currentSampleIndex <= nextStageSampleIndex) {
+        // stage of zero length, past its end forever
+        currentSampleIndex = nextStageSampleIndex + 1;
+    }
+}
+
+void Envelope::renderBlock4(Envelope * envelopes[4], float * pLevel, float * pMultiplier, int * pRemaining, float * pBuffers[4], int nFrames) {
+    using namespace simd;
+    int i = 0;
+    while (i < nFrames) {
+        // stage changes one lane at a time, same order as renderBlock()
+        for (int v = 0; v < 4; v++) {
+            if (pRemaining[v] == 0) {
+                Envelope * e = envelopes[v];
+                e->currentLevel = pLevel[v];
+                e->currentSampleIndex = e->nextStageSampleIndex;
+                e->enterStage(static_cast<EnvelopeStage>((e->currentStage + 1) % kNumEnvelopeStages));
+                e->getRenderState(pLevel[v], pMultiplier[v], pRemaining[v]);
+                // a stage of zero length never ends, like in renderBlock()
+                if (pRemaining[v] == 0) {
+                    pRemaining[v] = noStageChange;
+                }
+            }
+        }
+        int run = nFrames - i;
+        for (int v = 0; v < 4; v++) {
+            if (pRemaining[v] < run) {
+                run = pRemaining[v];
+            }
+        }
+        // all lanes run until the next stage change, four samples at a time transposed to the lanes
+        float4 level = load(pLevel);
+        const float4 multiplier = load(pMultiplier);
+        int j = i;
+        for (; j + 4 <= i + run; j += 4) {
+            float4 l0 = level = mul(level, multiplier);
+            float4 l1 = level = mul(level, multiplier);
+            float4 l2 = level = mul(level, multiplier);
+            float4 l3 = level = mul(level, multiplier);
+            transpose(l0, l1, l2, l3);
+            store(&pBuffers[0][j], l0);
+            store(&pBuffers[1][j], l1);
+            store(&pBuffers[2][j], l2);
+            store(&pBuffers[3][j], l3);
+        }
+        for (; j < i + run; j++) {
+            float l[4];
+            level = mul(level, multiplier);
+            store(l, level);
+            for (int v = 0; v < 4; v++) {
+                pBuffers[v][j] = l[v];
+            }
+        }
+        store(pLevel, level);
+        for (int v = 0; v < 4; v++) {
+            if (pRemaining[v] != noStageChange) {
+                pRemaining[v] -= run;
+            }
+        }
+        i += run;
+    }
+}
+
+void Envelope::setSampleRate(double newSampleRate) {
+    sampleRate = newSampleRate;
+}
+
+void Envelope::fadeOut(double seconds) {
+    if (currentStage == ENVELOPE_STAGE_OFF) return;
+    currentStage = ENVELOPE_STAGE_RELEASE;
+    currentSampleIndex = 0;
+    nextStageSampleIndex = seconds * sampleRate;
+    if (nextStageSampleIndex < 1) {
+        nextStageSampleIndex = 1;
+    }
+    calculateMultiplier(log(fmax(currentLevel, minimumLevel)),
+                        logMinimumLevel,
+                        nextStageSampleIndex);
+}
+
+void Envelope::calculateMultiplier(double logStartLevel,
+                                            double logEndLevel,
                                             unsigned long long lengthInSamples) {
-    multiplier = 1.0 + (log(endLevel) - log(startLevel)) / (lengthInSamples);
+    multiplier = 1.0 + (logEndLevel - logStartLevel) / (lengthInSamples);
 }
 
 void Envelope::enterStage(EnvelopeStage newStage) {
@@ -44,6 +199,7 @@ void Envelope::enterStage(EnvelopeStage newStage) {
 	if (newStage == ENVELOPE_STAGE_OFF) {
     	finishedEnvelopeCycle = true;
 	}
+    EnvelopeStage previousStage = currentStage;
     currentStage = newStage;
     currentSampleIndex = 0;
     if (currentStage == ENVELOPE_STAGE_OFF ||
@@ -59,14 +215,14 @@ void Envelope::enterStage(EnvelopeStage newStage) {
             break;
         case ENVELOPE_STAGE_ATTACK:
             currentLevel = minimumLevel;
-            calculateMultiplier(currentLevel,
-                                1.0,
+            calculateMultiplier(logMinimumLevel,
+                                0.0,
                                 nextStageSampleIndex);
             break;
         case ENVELOPE_STAGE_DECAY:
             currentLevel = 1.0;
-            calculateMultiplier(currentLevel,
-                                fmax(stageValue[ENVELOPE_STAGE_SUSTAIN], minimumLevel),
+            calculateMultiplier(0.0,
+                                logSustain,
                                 nextStageSampleIndex);
             break;
         case ENVELOPE_STAGE_SUSTAIN:
@@ -76,8 +232,10 @@ void Envelope::enterStage(EnvelopeStage newStage) {
         case ENVELOPE_STAGE_RELEASE:
             // We could go from ATTACK/DECAY to RELEASE,
             // so we're not changing currentLevel here.
-            calculateMultiplier(currentLevel,
-                                minimumLevel,
+            // From SUSTAIN the level is known and so is its log.
+            calculateMultiplier(previousStage == ENVELOPE_STAGE_SUSTAIN &&
+                                currentLevel == stageValue[ENVELOPE_STAGE_SUSTAIN] ? logSustain : log(currentLevel),
+                                logMinimumLevel,
                                 nextStageSampleIndex);
             break;
         default:
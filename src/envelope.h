@@ -19,6 +19,7 @@
 #pragma once
 
 #include <cmath>
+#include <climits>
 
 class Envelope {
 public:
@@ -46,14 +47,61 @@ public:
    	 * Calculate new sample.
    	 */
     void getNextSample(float * pSample);
-    /// New sample rate...
+    /**
+   	 * \brief Render a block of envelope samples.
+   	 * \param pBuffer Pointer to the buffer which is overwritten
+   	 * \param nFrames Number of samples to render
+   	 * 
+   	 * Same as calling getNextSample(float*) nFrames times, but works segment by segment:
+   	 * the samples left in the current stage are filled in one vectorized run
+   	 * (see renderSegment()) and stage changes are only checked between the runs.
+   	 */
+    void renderBlock(float * pBuffer, int nFrames);
+    /**
+   	 * \brief Render a block of four envelopes at once, one envelope per SIMD lane.
+   	 * \param envelopes The four envelopes, only used for stage changes (may be NULL for lanes that never change)
+   	 * \param pLevel Current level of the four envelopes, updated
+   	 * \param pMultiplier Current multiplier of the four envelopes, updated on stage changes
+   	 * \param pRemaining Samples until the next stage change (noStageChange if none), updated
+   	 * \param pBuffers Buffer of every envelope, overwritten
+   	 * \param nFrames Number of samples to render
+   	 * 
+   	 * The running state lives in structure-of-arrays form (see VoicePool) and is
+   	 * taken from and given back to the envelopes with getRenderState() and setRenderState().
+   	 * Between stage changes all four lanes run on SIMD, a stage change is handed
+   	 * to the envelope of its lane.
+   	 */
+    static void renderBlock4(Envelope * envelopes[4], float * pLevel, float * pMultiplier, int * pRemaining, float * pBuffers[4], int nFrames);
+    /**
+   	 * \brief Get the running state for renderBlock4().
+   	 * \param level Current level
+   	 * \param multiplier Current multiplier
+   	 * \param remaining Samples until the next stage change
+   	 */
+    void getRenderState(float & level, float & multiplier, int & remaining) const;
+    /// Take back the running state after renderBlock4().
+    void setRenderState(float level, float multiplier, int remaining);
+    static const int noStageChange = INT_MAX; ///< Remaining samples of stages that do not end by themselves
+    /// New sample rate, stage lengths are converted to samples with it on the next stage change.
     void setSampleRate(double newSampleRate);
+    /**
+   	 * \brief Release from the current level within a given time.
+   	 * \param seconds Length of the release ramp
+   	 * 
+   	 * Like entering the release stage, but ignores the release time set with setRelease().
+   	 * Does nothing if the envelope is off.
+   	 */
+    void fadeOut(double seconds);
     /// Get current stage in envelope
     inline EnvelopeStage getCurrentStage() const { return currentStage; };
+    /// Get current level
+    inline double getLevel() const { return currentLevel; };
     const double minimumLevel; ///< min volume 
+    const double logMinimumLevel; ///< log(minimumLevel)
     /// Default envelope
     Envelope() :
     minimumLevel(0.0001),
+    logMinimumLevel(log(minimumLevel)),
     currentStage(ENVELOPE_STAGE_OFF),
     finishedEnvelopeCycle(true),
     currentLevel(minimumLevel),
@@ -66,6 +114,7 @@ public:
         stageValue[ENVELOPE_STAGE_DECAY] = 0.5;
         stageValue[ENVELOPE_STAGE_SUSTAIN] = 0.1;
         stageValue[ENVELOPE_STAGE_RELEASE] = 1.0;
+        logSustain = log(stageValue[ENVELOPE_STAGE_SUSTAIN]);
     };
  	bool finishedEnvelopeCycle;
  	/// Set Attack
@@ -73,7 +122,9 @@ public:
     /// Set Decay
     void setDecay(double val){stageValue[ENVELOPE_STAGE_DECAY] = val;}
     /// Set Sustain
-    void setSustain(double val){stageValue[ENVELOPE_STAGE_SUSTAIN] = val;}
+    void setSustain(double val){stageValue[ENVELOPE_STAGE_SUSTAIN] = val; logSustain = log(fmax(val, minimumLevel));}
+    /// Get Sustain
+    double getSustain() const {return stageValue[ENVELOPE_STAGE_SUSTAIN];}
     /// Set Release
     void setRelease(double val){stageValue[ENVELOPE_STAGE_RELEASE] = val;}
 private:
@@ -82,14 +133,25 @@ private:
     double multiplier; ///< Value to be applied on target sample
     double sampleRate; ///< sample rate
     double stageValue[kNumEnvelopeStages]; ///< stage number
+    double logSustain; ///< log of the sustain level (at least minimumLevel), kept up to date by setSustain()
     /**
    	 * \brief Calculates the value to be applied on target sample
-   	 * \param startLevel starting point of level change
-   	 * \param endLevel end point of level change
+   	 * \param logStartLevel log of the starting point of level change
+   	 * \param logEndLevel log of the end point of level change
 	 * \param lengthInSamples length of the change ramp
    	 * 
+   	 * Takes logarithms, so the constant levels (minimum, 1.0, sustain) need no log() on a stage change.
+   	 */
+    void calculateMultiplier(double logStartLevel, double logEndLevel, unsigned long long lengthInSamples);
+    /**
+   	 * \brief Fills a run of samples of the current stage.
+   	 * \param pBuffer Pointer to the run, overwritten
+   	 * \param nFrames Number of samples, none of them may change the stage
+   	 * 
+   	 * The exponential segment is generated four samples at a time in float,
+   	 * the level in double precision is advanced once at the end of the run.
    	 */
-    void calculateMultiplier(double startLevel, double endLevel, unsigned long long lengthInSamples);
+    void renderSegment(float * pBuffer, int nFrames);
     unsigned long long currentSampleIndex; ///< current index of sample
     unsigned long long nextStageSampleIndex; ///< number of next envelope stage
 };
@@ -46,6 +46,10 @@ public:
 	double getFeedbackOutput(){return m_dBeta * m_dZ1;}
 	/// Reset memory
 	void reset(){m_dZ1 = 0;}
+	/// Get z-1 memory, used by the voice-parallel ladder
+	double getState() const {return m_dZ1;}
+	/// Set z-1 memory, used by the voice-parallel ladder
+	void setState(double z1){m_dZ1 = z1;}
 	/// Apply the filter to a sample
 	void doFilter(float * xn);
 	enum{LPF1,HPF1,LPF2,HPF2,BPF2,BSF2,LPF4,HPF4,BPF4};
@@ -3,10 +3,7 @@
 
 void Key::setFrequency(float f) {
 		_frequency = f;
-		sine.setFrequency(_frequency);
-        square.setFrequency(_frequency);
-        triangle.setFrequency(_frequency);
-        sawtooth.setFrequency(_frequency);
+		oscillator.setFrequency(_frequency);
 }
 float Key::getNextSample() {
 	if (!isActive || volumeEnvelope.finishedEnvelopeCycle ) {
@@ -19,10 +16,7 @@ float Key::getNextSample() {
 	//cout << filterEnvelopeValue << "\t" << endl;
 	if(filterEnvelopeValue > 0)
 		moog.setCutOff(filterEnvelopeValue * _cutOff);
-	return moog.doFilter((_gamma * (sine.getNextAntiAliasedSample() *  _alpha + square.getNextAntiAliasedSample() *  (1-_alpha)) + 
-    	(1-_gamma)*(triangle.getNextAntiAliasedSample() * _beta + sawtooth.getNextAntiAliasedSample() * (1-_beta))) * 
-    	volumeEnvelopeValue * 
-    	_velocity/127.0);
+	return moog.doFilter(oscillator.getNextMixSample(_mix) * volumeEnvelopeValue);
 }
 
 void Key::getNextSample(float * pSample, float * fLFO) {
@@ -39,17 +33,7 @@ void Key::getNextSample(float * pSample, float * fLFO) {
 		if(filterEnvelopeValue > 0)
 			moog.setCutOff(filterEnvelopeValue * _cutOff * (*fLFO + 1.0));
 
-		sineValue = squValue = sawValue = triValue = 0.0;
-
-		sine.getNextAntiAliasedSample(&sineValue);
-		square.getNextAntiAliasedSample(&squValue);
-		triangle.getNextAntiAliasedSample(&triValue);
-		sawtooth.getNextAntiAliasedSample(&sawValue);
-
-		float sample = (_gamma * (sineValue *  _alpha + squValue *  (1-_alpha)) + 
-	    	(1-_gamma)*(triValue * _beta + sawValue * (1-_beta))) * 
-	    	volumeEnvelopeValue * 
-	    	_velocity/127.0;
+		float sample = oscillator.getNextMixSample(_mix) * volumeEnvelopeValue;
 	    moog.doFilter(&sample);
 	    *pSample += sample;
 	}
@@ -71,17 +55,7 @@ void Key::getNextSample(float * pBuffer, int nFrames) {
 			if(filterEnvelopeValue > 0.0 )
 				moog.setCutOff(filterEnvelopeValue * _cutOff * (filterLFO.getNextSample()+1.0));
 
-			sineValue = squValue = sawValue = triValue = 0.0;
-
-			sine.getNextAntiAliasedSample(&sineValue);
-			square.getNextAntiAliasedSample(&squValue);
-			triangle.getNextAntiAliasedSample(&triValue);
-			sawtooth.getNextAntiAliasedSample(&sawValue);
-
-			sample = (_gamma * (sineValue *  _alpha + squValue *  (1-_alpha)) + 
-		    	(1-_gamma)*(triValue * _beta + sawValue * (1-_beta))) * 
-		    	volumeEnvelopeValue * 
-		    	_velocity/127.0;
+			sample = oscillator.getNextMixSample(_mix) * volumeEnvelopeValue;
 
 		    moog.doFilter(&sample);
 
@@ -90,18 +64,159 @@ void Key::getNextSample(float * pBuffer, int nFrames) {
 	}
 }
 
+bool Key::renderBlock(float * pBuffer, const float * pLFO, int nFrames) {
+	if (!isActive || volumeEnvelope.finishedEnvelopeCycle ) 
+	{
+		filterEnvelope.enterStage(Envelope::ENVELOPE_STAGE_OFF);
+		isActive = false;
+		return false;
+	}
+	applyPatch();
+	float sampleBuffer[maxBlockSize];
+	float gBuffer[maxBlockSize];
+	float volumeEnvelopeBuffer[maxBlockSize];
+	float filterEnvelopeBuffer[maxBlockSize];
+
+	volumeEnvelope.renderBlock(volumeEnvelopeBuffer, nFrames);
+	filterEnvelope.renderBlock(filterEnvelopeBuffer, nFrames);
+	renderVoice(sampleBuffer, gBuffer, pLFO, volumeEnvelopeBuffer, filterEnvelopeBuffer, nFrames);
+	moog.renderBlock(sampleBuffer, gBuffer, nFrames);
+
+	for(int i = 0; i < nFrames; i++) {
+		pBuffer[i] += sampleBuffer[i];
+	}
+	return stillActive();
+}
+
+void Key::renderVoice(float * pVoice, float * pG, const float * pLFO, const float * pVolumeEnvelope, const float * pFilterEnvelope, int nFrames) {
+	const float * volumeEnvelopeBuffer = pVolumeEnvelope;
+	const float * filterEnvelopeBuffer = pFilterEnvelope;
+
+	// all four waves, vector mix, velocity and volume envelope in one pass
+	oscillator.renderMix(pVoice, _mix, volumeEnvelopeBuffer, nFrames);
+
+	// cut-off modulation at control rate, G is interpolated in between.
+	// cut-off only follows the filter envelope while it is non-zero
+	if(_filterSnap && filterEnvelopeBuffer[0] > 0) {
+		// new note, start right at the modulated cut-off instead of ramping from the old one
+		_filterCutOff = filterEnvelopeBuffer[0] * _cutOff * (pLFO[0] + 1.0);
+		_filterG = moog.lookUpG(_filterCutOff);
+	}
+	_filterSnap = false;
+	for(int i = 0; i < nFrames; i += controlInterval) {
+		int n = nFrames - i < controlInterval ? nFrames - i : controlInterval;
+		int last = i + n - 1;
+		float targetG = _filterG;
+		if(filterEnvelopeBuffer[last] > 0) {
+			_filterCutOff = filterEnvelopeBuffer[last] * _cutOff * (pLFO[last] + 1.0);
+			targetG = moog.lookUpG(_filterCutOff);
+		}
+		float step = (targetG - _filterG) / n;
+		for(int j = 0; j < n; j++) {
+			pG[i+j] = _filterG + step * (j + 1);
+		}
+		_filterG = targetG;
+	}
+}
+
+bool Key::stillActive() {
+	if (volumeEnvelope.finishedEnvelopeCycle) {
+		filterEnvelope.enterStage(Envelope::ENVELOPE_STAGE_OFF);
+		isActive = false;
+	}
+	return isActive;
+}
+
+void Key::setSampleRate(int sampleRate) {
+	oscillator.setSampleRate(sampleRate);
+	filterLFO.setSampleRate(sampleRate);
+	volumeEnvelope.setSampleRate(sampleRate);
+	filterEnvelope.setSampleRate(sampleRate);
+	moog.setSampleRate(sampleRate);
+	// same cut-off, new coefficient
+	_filterG = moog.lookUpG(_filterCutOff);
+}
+
+bool Key::applyPatch() {
+	if(_patch == NULL || _patchVersion == _patch->getVersion())
+		return false;
+	_patchVersion = _patch->getVersion();
+	if(_alpha != _patch->getAlpha() || _beta != _patch->getBeta() || _gamma != _patch->getGamma()) {
+		setOscillatorMix(_patch->getAlpha(), _patch->getBeta(), _patch->getGamma());
+	}
+	// the filter coefficients follow from _cutOff per control interval in renderVoice()
+	_cutOff = _patch->getCutOff();
+	moog.setResonance(_patch->getResonance());
+	volumeEnvelope.setAttack(_patch->getAttack());
+	volumeEnvelope.setDecay(_patch->getDecay());
+	if(volumeEnvelope.getSustain() != _patch->getSustain()) {
+		volumeEnvelope.setSustain(_patch->getSustain());
+	}
+	volumeEnvelope.setRelease(_patch->getRelease());
+	filterEnvelope.setAttack(_patch->getFilterAttack());
+	filterEnvelope.setDecay(_patch->getFilterDecay());
+	if(filterEnvelope.getSustain() != _patch->getFilterSustain()) {
+		filterEnvelope.setSustain(_patch->getFilterSustain());
+	}
+	filterEnvelope.setRelease(_patch->getFilterRelease());
+	if(moog.m_uFilterType != _patch->getFilterType()) {
+		moog.setFilter(_patch->getFilterType());
+	}
+	return true;
+}
+
+void Key::setOversampling(int factor) {
+	moog.setOversampling(factor);
+	// G depends on the rate of the ladder
+	_filterG = moog.lookUpG(_filterCutOff);
+}
+
 void Key::setOscillatorMix(float alpha, float beta, float gamma) {
 	_alpha = alpha;
 	_beta = beta;
 	_gamma = gamma;
+	updateMix();
+}
+void Key::updateMix() {
+	float gain = _velocity / 127.0;
+	_mix[WaveTables::MIP_CUSTOM] = _gamma * _alpha * gain;
+	_mix[WaveTables::MIP_SQUARE] = _gamma * (1 - _alpha) * gain;
+	_mix[WaveTables::MIP_TRIANGLE] = (1 - _gamma) * _beta * gain;
+	_mix[WaveTables::MIP_SAWTOOTH] = (1 - _gamma) * (1 - _beta) * gain;
 }
 void Key::reset() {
 	_keyNumber = -1;
+	_filterSnap = true;
+	_fading = false;
 	_velocity = 0;
-	sine.reset();
-	square.reset();
-	triangle.reset();
-	sawtooth.reset();
+	updateMix();
+	oscillator.reset();
+}
+void Key::noteOn(int keyNumber, float velocity, float frequency) {
+	// the envelope times are read when a stage begins
+	applyPatch();
+	reset();
+	setFrequency(frequency);
+	setKeyNumber(keyNumber);
+	setVelocity(velocity);
+	setActive();
+	volumeEnvelope.enterStage(Envelope::ENVELOPE_STAGE_ATTACK);
+	filterEnvelope.enterStage(Envelope::ENVELOPE_STAGE_ATTACK);
+}
+void Key::noteOff() {
+	applyPatch();
+	volumeEnvelope.enterStage(Envelope::ENVELOPE_STAGE_RELEASE);
+	filterEnvelope.enterStage(Envelope::ENVELOPE_STAGE_RELEASE);
+}
+void Key::fadeOut(double seconds) {
+	_keyNumber = -1;
+	_fading = true;
+	volumeEnvelope.fadeOut(seconds);
+}
+void Key::retire() {
+	volumeEnvelope.enterStage(Envelope::ENVELOPE_STAGE_OFF);
+	filterEnvelope.enterStage(Envelope::ENVELOPE_STAGE_OFF);
+	isActive = false;
 }
 void Key::setFree() {
 	isActive = false;
@@ -114,6 +229,7 @@ void Key::setKeyNumber(int keyNumber) {
 }
 void Key::setVelocity(float velocity) {
 	_velocity = velocity;
+	updateMix();
 }
 // value is in Hz
 void Key::setCutOff(float value) {
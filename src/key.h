@@ -5,6 +5,8 @@
  * \brief Key generates the tone of one key with 4 oscillators.
  *
  * This class generates the tone of one key with 4 oscillators, LPF, volume- and cut-off envelope.
+ * All four waves have the same frequency and phase, so they are rendered by one WaveGen
+ * (WaveGen::renderMix()) with the vector mix and velocity folded into four gains.
  *
  * \author $Author: Corvin Jaedicke & Alberto Monciero $
  *
@@ -25,6 +27,7 @@
 #include <cmath>
 #include "waveGen.h"
 #include "moogLadderFilter.h"
+#include "patch.h"
 #include "envelope.h"
 
 using std::cout;
@@ -34,6 +37,7 @@ class Key
 {
 public:
 	friend class Midi2KeyHandler;
+	friend class VoicePool;
 	/// Make a key with everything on default
 	Key()
 	: _velocity(0.0),
@@ -46,17 +50,16 @@ public:
 	isActive(false),
 	volumeEnvelopeValue(0.0),
 	filterEnvelopeValue(0.0),
-	sineValue(0.0),
-	sawValue(0.0),
-	triValue(0.0),
-	squValue(0.0) {
-		sine.setType(CUSTOM_WAVE);
-        square.setType(SQUARE);
-        triangle.setType(TRIANGLE);
-        sawtooth.setType(SAWTOOTH);
+	_filterCutOff(10000.0),
+	_filterSnap(true),
+	_fading(false),
+	_patch(NULL),
+	_patchVersion(0) {
+		updateMix();
         filterLFO.setType(SINUS);
         filterLFO.setFrequency(2.0);
         filterLFO.setAmplitude(0.5);
+        _filterG = moog.getG();
 	};
 
 	/**
@@ -87,6 +90,67 @@ public:
    	 * Calculate new sample and applie Filter LFO.
    	 */
 	void getNextSample(float * pSample, float * fLFO);
+	/**
+   	 * \brief Render a block of samples.
+   	 * \param pBuffer Pointer to audio-buffer, the key adds its samples to it
+   	 * \param pLFO Filter LFO value for every sample of the block
+   	 * \param nFrames Size of block, has to be <= maxBlockSize
+   	 * 
+   	 * \return false if the key has finished its envelope cycle and is free again
+   	 * 
+   	 * Renders envelopes, oscillators and filter stage by stage, each in its own tight loop.
+   	 */
+	bool renderBlock(float * pBuffer, const float * pLFO, int nFrames);
+	/**
+   	 * \brief Render a block of the voice without envelopes and filter.
+   	 * \param pVoice Pointer to block, overwritten with the unfiltered voice
+   	 * \param pG Pointer to block, overwritten with the filter coefficient for every sample
+   	 * \param pLFO Filter LFO value for every sample of the block
+   	 * \param pVolumeEnvelope Volume envelope for every sample of the block
+   	 * \param pFilterEnvelope Filter envelope for every sample of the block
+   	 * \param nFrames Size of block, has to be <= maxBlockSize
+   	 * 
+   	 * Lets the caller run the envelopes and filters of several keys at once
+   	 * (see VoicePool, Envelope::renderBlock4() and MoogLadderFilter::renderBlock4()).
+   	 * Cut-off modulation (filter envelope and LFO) is evaluated every controlInterval samples,
+   	 * the filter coefficient is linearly interpolated in between.
+   	 * Only call this on active keys and call stillActive() once the block is done.
+   	 */
+	void renderVoice(float * pVoice, float * pG, const float * pLFO, const float * pVolumeEnvelope, const float * pFilterEnvelope, int nFrames);
+	/**
+   	 * \brief Frees the key if its volume envelope has finished.
+   	 * \return true if the key is still playing
+   	 */
+	bool stillActive();
+	/**
+   	 * \brief Starts a new note on this key.
+   	 * \param keyNumber Key number (midi)
+   	 * \param velocity Velocity (0..127)
+   	 * \param frequency Frequency of the note
+   	 * 
+   	 * Resets the key, activates it and starts both envelopes with the attack stage.
+   	 */
+	void noteOn(int keyNumber, float velocity, float frequency);
+	/// Moves both envelopes to the release stage.
+	void noteOff();
+	/**
+   	 * \brief Fades the key out quickly, e.g. when its voice is stolen.
+   	 * \param seconds Length of the fade
+   	 * 
+   	 * The key no longer belongs to its key number, so a later note-off does not touch it.
+   	 * It becomes free as soon as the fade is done.
+   	 */
+	void fadeOut(double seconds = 0.005);
+	/// true while the key fades out after fadeOut()
+	bool isFading() const {return _fading;}
+	/// true while the volume envelope is in its release stage (after noteOff() or fadeOut())
+	bool isReleased() const {return volumeEnvelope.getCurrentStage() == Envelope::ENVELOPE_STAGE_RELEASE;}
+	/**
+   	 * \brief Ends the note at once, both envelopes are switched off.
+   	 * 
+   	 * For keys whose release has become inaudible, the key is free again after stillActive().
+   	 */
+	void retire();
 	/// De-activates this key.
 	void setFree();
 	/// Activates this key.
@@ -99,6 +163,8 @@ public:
 	void setVelocity(float velocity);
 	/// Set Cut-off frequency
 	void setCutOff(float value);
+	/// Set sample rate of all oscillators, envelopes and the filter
+	void setSampleRate(int sampleRate);
 	/// Set volume envelope attack
 	void setAttack(float value){volumeEnvelope.setAttack(value);}
 	/// Set volume envelope decay
@@ -109,6 +175,23 @@ public:
 	void setRelease(float value){volumeEnvelope.setRelease(value);}
 	/// Set filter resonance
 	void setResonance(float value){moog.setResonance(value);}
+	/// Set the tanh implementation of the filter saturation
+	void setSaturation(Saturation::Mode mode){moog.setSaturation(mode);}
+	/// Set the oversampling factor of the filter (1, 2 or 4)
+	void setOversampling(int factor);
+	/**
+   	 * \brief Let the key follow a shared patch instead of its own setters.
+   	 * \param patch Patch read by applyPatch(), NULL to stop following
+   	 */
+	void setPatch(const Patch * patch){_patch = patch; _patchVersion = 0;}
+	/**
+   	 * \brief Copies wave mix, filter and both envelopes from the patch if it changed.
+   	 * 
+   	 * Called by noteOn(), noteOff(), renderBlock() and by Midi2KeyHandler before a chunk is rendered.
+   	 * Only compares the version if nothing changed.
+   	 * \return true if the values were copied (a VoicePool slot then needs new filter parameters)
+   	 */
+	bool applyPatch();
 	/// Set filter to low-pass 4
 	void setLPF4(){moog.setFilter(moog.LPF4);}
 	/// Set filter to low-pass 2
@@ -124,11 +207,10 @@ public:
 	/// Reset key to no key number and WaveGen to phase zero etc.
 	void reset();
 	bool isActive; ///< true if Key is playing 
+	static const int maxBlockSize = 64; ///< max number of samples rendered by renderBlock() at once
+	static const int controlInterval = 16; ///< Cut-off modulation is evaluated every controlInterval samples
 private:
-    WaveGen sine; ///< Custom-Wave (should be re-named)
-    WaveGen square; ///< Square-Wave
-    WaveGen triangle; ///< Triangle-Wave
-    WaveGen sawtooth; ///< Sawtooth-Wave
+    WaveGen oscillator; ///< Phase of all four waves (custom, square, triangle, sawtooth)
     MoogLadderFilter moog; ///< Moog-Ladder-Filter
     Envelope volumeEnvelope; ///< Volume envelope
     Envelope filterEnvelope; ///< Filter envelope
@@ -142,8 +224,13 @@ private:
     float _cutOff; ///< Cut-off frequency
     float volumeEnvelopeValue; ///< Volume envelope sample
 	float filterEnvelopeValue; ///< Filter envelope sample
-	float sineValue; ///< Custom-Wave sample
-	float sawValue; ///< Saw-Wave sample
-	float triValue; ///< Triangle sample
-	float squValue; ///< Square-Wave sample
+	float _mix[WaveTables::numMipWaves]; ///< Gain of every wave: vector mix times velocity, indexed by WaveTables::MipWave
+	/// Recalculates _mix from _alpha, _beta, _gamma and _velocity.
+	void updateMix();
+	float _filterCutOff; ///< Modulated cut-off frequency of the last rendered sample
+	float _filterG; ///< Filter coefficient belonging to _filterCutOff
+	bool _filterSnap; ///< If true the next block starts at the modulated cut-off without interpolation
+	bool _fading; ///< true after fadeOut() until the next note
+	const Patch * _patch; ///< Shared parameters, NULL if the key is set up by its own setters
+	unsigned int _patchVersion; ///< Version of _patch copied last
 };
\ No newline at end of file
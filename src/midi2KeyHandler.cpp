@@ -1,6 +1,12 @@
 #include "midi2KeyHandler.h"
 
-void Midi2KeyHandler::mapMidi(MidiMan::midiMessage m)
+#include <chrono>
+#include <new>
+
+constexpr float Midi2KeyHandler::shedLoad;
+constexpr float Midi2KeyHandler::defaultSmoothingTime;
+
+void Midi2KeyHandler::mapMidi(midiMessage m)
 {
     switch(m.byte1) {
         case 176:
@@ -10,9 +16,7 @@ void Midi2KeyHandler::mapMidi(MidiMan::midiMessage m)
                         //alpha = (float) (m.byte3-64/127.0; // pos range from 1 to 127
                         alpha = 0.5 + 0.5 * (float) m.byte3/127.0;
                         beta = alpha;
-                        for(int i = 0; i < numberOfKeys; i++) {
-                        	keys[i].setOscillatorMix(alpha, beta, gamma);
-                        }
+                        alphaSmoother.setTarget(alpha);
                     }
                     break;
                 case 74: // negative y direction
@@ -20,42 +24,27 @@ void Midi2KeyHandler::mapMidi(MidiMan::midiMessage m)
                         alpha = 1.0 - (float) m.byte3/127.0;
                         //alpha = (float) m.byte3/127.0;
                         beta = alpha;
-                        for(int i = 0; i < numberOfKeys; i++) {
-                        	keys[i].setOscillatorMix(alpha, beta, gamma);
-                        }
+                        alphaSmoother.setTarget(alpha);
                     }
                     break;
                 case 71: // Release
-                    for(int i = 0; i < numberOfKeys; i++) {
-                        keys[i].setRelease((float) m.byte3 * 0.05);
-                    }
+                    patch.setRelease((float) m.byte3 * 0.05);
                     break;
                 case 73: // attack
-                    for(int i = 0; i < numberOfKeys; i++) {
-                        keys[i].setAttack((float) m.byte3 / 127.0);
-                    }
+                    patch.setAttack((float) m.byte3 / 127.0);
                     break;
                 case 75: // decay
-                    for(int i = 0; i < numberOfKeys; i++) {
-                        //keys[i].setDecay((float) m.byte3 / 127.0);
-                        keys[i].volumeEnvelope.setDecay((float) m.byte3 / 127.0);
-                    }
+                    patch.setDecay((float) m.byte3 / 127.0);
                     break;
                 case 72: // sustain
-                    for(int i = 0; i < numberOfKeys; i++) {
-                        keys[i].setSustain((float) m.byte3 / 127.0);
-                    }
+                    patch.setSustain((float) m.byte3 / 127.0);
                     break;
                 case 76: //cutoff
-                    for(int i = 0; i < numberOfKeys; i++) {
-                    	cutOff = (exp((float) m.byte3 /127.0)-1.0) * maxCutOff + 20.0;
-                        keys[i].setCutOff(cutOff);
-                    }
+                    cutOff = (exp((float) m.byte3 /127.0)-1.0) * maxCutOff + 20.0;
+                    cutOffSmoother.setTarget(cutOff);
                     break;
                 case 77: // resonance
-                    for(int i = 0; i < numberOfKeys; i++) {
-                        keys[i].setResonance((float) m.byte3 * 0.0315); // 4/127
-                    }
+                    resonanceSmoother.setTarget((float) m.byte3 * 0.0315); // 4/127
                     break;
                 case 78: // rate
                     maxCutOff = (float) m.byte3 * 78.7;
@@ -70,13 +59,13 @@ void Midi2KeyHandler::mapMidi(MidiMan::midiMessage m)
         case 224: // x direction
             if(!holdOn) {
                 gamma = (float) m.byte3/127.0;
-                for(int i = 0; i < numberOfKeys; i++) {
-                        	keys[i].setOscillatorMix(alpha, beta, gamma);
-                }
+                gammaSmoother.setTarget(gamma);
             }
             break;
         case 144:
-            onKeyPressed(m.byte2, (float) m.byte3, freq[m.byte2-9]);
+            // freq starts at note 9, notes outside the table are ignored
+            if(m.byte2 >= 9 && m.byte2 - 9 < (int) (sizeof(freq) / sizeof(freq[0])))
+                onKeyPressed(m.byte2, (float) m.byte3, freq[m.byte2-9]);
             //frequency = freq[m.byte2-9];
             break;
         case 128:
@@ -85,34 +74,22 @@ void Midi2KeyHandler::mapMidi(MidiMan::midiMessage m)
         case 153:
             switch(m.byte2) {
                 case 36:
-                    for(int i = 0; i < numberOfKeys; i++) {
-                        keys[i].setLPF4();
-                    }
+                    patch.setFilterType(MoogLadderFilter::LPF4);
                     break;
                 case 40:
-                    for(int i = 0; i < numberOfKeys; i++) {
-                        keys[i].setLPF2();
-                    }
+                    patch.setFilterType(MoogLadderFilter::LPF2);
                     break;
                 case 43:
-                    for(int i = 0; i < numberOfKeys; i++) {
-                        keys[i].setHPF4();
-                    }
+                    patch.setFilterType(MoogLadderFilter::HPF4);
                     break;
                 case 42:
-                    for(int i = 0; i < numberOfKeys; i++) {
-                        keys[i].setBPF4();
-                    }
+                    patch.setFilterType(MoogLadderFilter::BPF4);
                     break;
                 case 46:
-                    for(int i = 0; i < numberOfKeys; i++) {
-                        keys[i].setBPF2();
-                    }
+                    patch.setFilterType(MoogLadderFilter::BPF2);
                     break;
                 case 45:
-                    for(int i = 0; i < numberOfKeys; i++) {
-                        keys[i].setHPF2();
-                    }
+                    patch.setFilterType(MoogLadderFilter::HPF2);
                     break;
                 case 48:
                     holdOn = !holdOn;
@@ -135,24 +112,16 @@ void Midi2KeyHandler::mapMidi(MidiMan::midiMessage m)
         			cutOffLFO->setAmplitude( (float) m.byte3 * 0.004);
         			break;
         		case 7:
-        			for(int i = 0; i < numberOfKeys; i++) {
-                        keys[i].filterEnvelope.setAttack((float) m.byte3 / 127.0);
-                    }
+        			patch.setFilterAttack((float) m.byte3 / 127.0);
         			break;
         		case 1:
-        			for(int i = 0; i < numberOfKeys; i++) {
-                        keys[i].filterEnvelope.setDecay((float) m.byte3 / 127.0 + 0.008); // +1/127, never zero!
-                    }
+        			patch.setFilterDecay((float) m.byte3 / 127.0 + 0.008); // +1/127, never zero!
         			break;
         		case 71:
-        			for(int i = 0; i < numberOfKeys; i++) {
-                        keys[i].filterEnvelope.setSustain((float) m.byte3 / 127.0 + 0.008); // +1/127, never zero!
-                    }
+        			patch.setFilterSustain((float) m.byte3 / 127.0 + 0.008); // +1/127, never zero!
         			break;        	
         		case 74:
-        			for(int i = 0; i < numberOfKeys; i++) {
-                        keys[i].filterEnvelope.setRelease((float) m.byte3 * 0.0315 + 0.008);
-                    }
+        			patch.setFilterRelease((float) m.byte3 * 0.0315 + 0.008);
         			break;        					
         	}
         break;
@@ -175,6 +144,75 @@ void Midi2KeyHandler::mapMidi(MidiMan::midiMessage m)
 
 }
 
+void Midi2KeyHandler::setSampleRate(int fs) {
+    unloadAllKeys();
+    sampleRate = fs;
+    globalLFO->setSampleRate(sampleRate);
+    cutOffLFO->setSampleRate(sampleRate);
+    for(int i = 0; i < numberOfKeys; i++) {
+        keys[i].setSampleRate(sampleRate);
+    }
+    alphaSmoother.setSampleRate(sampleRate);
+    gammaSmoother.setSampleRate(sampleRate);
+    cutOffSmoother.setSampleRate(sampleRate);
+    resonanceSmoother.setSampleRate(sampleRate);
+}
+
+void Midi2KeyHandler::setSmoothingTime(float seconds) {
+    alphaSmoother.setTime(seconds);
+    gammaSmoother.setTime(seconds);
+    cutOffSmoother.setTime(seconds);
+    resonanceSmoother.setTime(seconds);
+}
+
+void Midi2KeyHandler::updateParameters(int frames) {
+    if(!parametersSmoothing())
+        return;
+    float a = alphaSmoother.process(frames);
+    patch.setOscillatorMix(a, a, gammaSmoother.process(frames));
+    patch.setCutOff(cutOffSmoother.process(frames));
+    patch.setResonance(resonanceSmoother.process(frames));
+}
+
+void Midi2KeyHandler::setSaturation(Saturation::Mode mode) {
+    unloadAllKeys();
+    for(int i = 0; i < numberOfKeys; i++) {
+        keys[i].setSaturation(mode);
+    }
+}
+
+void Midi2KeyHandler::setOversampling(int factor) {
+    unloadAllKeys();
+    for(int i = 0; i < numberOfKeys; i++) {
+        keys[i].setOversampling(factor);
+    }
+}
+
+void * Midi2KeyHandler::operator new(size_t size) {
+    void * pointer;
+    if(posix_memalign(&pointer, VoicePool::cacheLineSize, size) != 0) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void Midi2KeyHandler::operator delete(void * pointer) {
+    free(pointer);
+}
+
+void Midi2KeyHandler::unloadKey(int k) {
+    if(poolSlot[k] >= 0) {
+        voicePool.store(poolSlot[k], keys[k]);
+        poolSlot[k] = -1;
+    }
+}
+
+void Midi2KeyHandler::unloadAllKeys() {
+    for(int i = 0; i < numActiveKeys; i++) {
+        unloadKey(activeKeys[i]);
+    }
+}
+
 Key* Midi2KeyHandler::findFreeKey() {
     Key* freeKey = NULL;
     for(int i = 0; i < numberOfKeys; i++) {
@@ -186,41 +224,324 @@ Key* Midi2KeyHandler::findFreeKey() {
     return freeKey;
 }
 
+int Midi2KeyHandler::findKeyToSteal(int keyNumber, bool force) {
+    int oldest = -1;
+    int oldestReleased = -1;
+    int oldestSameNote = -1;
+    int quietest = -1;
+    for(int i = 0; i < numActiveKeys; i++) {
+        int k = activeKeys[i];
+        if(keys[k].isFading()) {
+            continue;
+        }
+        if(oldest < 0 || noteOrder[k] < noteOrder[oldest]) {
+            oldest = k;
+        }
+        if(keys[k].volumeEnvelope.getCurrentStage() == Envelope::ENVELOPE_STAGE_RELEASE &&
+           (oldestReleased < 0 || noteOrder[k] < noteOrder[oldestReleased])) {
+            oldestReleased = k;
+        }
+        if(keys[k]._keyNumber == keyNumber &&
+           (oldestSameNote < 0 || noteOrder[k] < noteOrder[oldestSameNote])) {
+            oldestSameNote = k;
+        }
+        if(quietest < 0 || getKeyLevel(k) < getKeyLevel(quietest)) {
+            quietest = k;
+        }
+    }
+    if(stealPolicy == STEAL_SAME_NOTE && oldestSameNote >= 0) {
+        return oldestSameNote;
+    }
+    if(!force) {
+        return -1;
+    }
+    switch(stealPolicy) {
+        case STEAL_QUIETEST:
+            return quietest;
+        case STEAL_SAME_NOTE:
+        case STEAL_RELEASED_FIRST:
+            return oldestReleased >= 0 ? oldestReleased : oldest;
+        case STEAL_OLDEST:
+        default:
+            return oldest;
+    }
+}
+
 void Midi2KeyHandler::onKeyPressed(int keyNumber, float velocity, float frequency) {
+    int numSounding = 0;
+    for(int i = 0; i < numActiveKeys; i++) {
+        if(!keys[activeKeys[i]].isFading()) {
+            numSounding++;
+        }
+    }
+    int stolen = findKeyToSteal(keyNumber, numSounding >= polyphony);
+    if(stolen >= 0) {
+        unloadKey(stolen);
+        keys[stolen].fadeOut();
+        numSounding--;
+    }
+    // the polyphony may have been lowered below the number of sounding keys
+    while(numSounding >= polyphony && (stolen = findKeyToSteal(keyNumber, true)) >= 0) {
+        unloadKey(stolen);
+        keys[stolen].fadeOut();
+        numSounding--;
+    }
     Key* key = findFreeKey();
-    if (!key) {
-        return;
+    if (key) {
+        activeKeys[numActiveKeys++] = key - keys;
+    } else {
+        // all spare keys are still fading, cut the quietest of them
+        for(int i = 0; i < numActiveKeys; i++) {
+            Key* k = &(keys[activeKeys[i]]);
+            if(k->isFading() && (!key || getKeyLevel(activeKeys[i]) < getKeyLevel(key - keys))) {
+                key = k;
+            }
+        }
+        if (!key) {
+            return;
+        }
     }
-    key->reset();
-    key->setFrequency(frequency);
-    key->setKeyNumber(keyNumber);
-    key->setVelocity(velocity);
-    key->setActive();
-    key->volumeEnvelope.enterStage(Envelope::ENVELOPE_STAGE_ATTACK);
-    key->filterEnvelope.enterStage(Envelope::ENVELOPE_STAGE_ATTACK);
-
+    unloadKey(key - keys);
+    key->noteOn(keyNumber, velocity, frequency);
+    noteOrder[key - keys] = noteCounter++;
 }
 void Midi2KeyHandler::onKeyReleased(int keyNumber, float velocity) {
-    for(int i = 0; i < numberOfKeys; i++) {
-        Key& key = keys[i];
-        if(key.isActive && key._keyNumber == keyNumber ) {
-            key.volumeEnvelope.enterStage(Envelope::ENVELOPE_STAGE_RELEASE);
-            key.filterEnvelope.enterStage(Envelope::ENVELOPE_STAGE_RELEASE);
+    for(int i = 0; i < numActiveKeys; i++) {
+        Key& key = keys[activeKeys[i]];
+        if(key._keyNumber == keyNumber ) {
+            unloadKey(activeKeys[i]);
+            key.noteOff();
         }
     }
 }
 
 void Midi2KeyHandler::getNextSampleBuffer(float * buffer, int frames) {
-    float cutOffLFOValue = 0.0;
-    for(int j = 0; j < frames; j++) {
-        buffer[j] = 0.0;
-        cutOffLFOValue = cutOffLFO->getNextSample();
-        for (int i = 0; i < numberOfKeys; i++) {
-            Key& key = keys[i];
-            key.getNextSample(&(buffer[j]), &cutOffLFOValue);
+    RealtimeCheck::Scope realtime;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    renderFrames(buffer, frames);
+    updateLoad(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), frames);
+}
+
+void Midi2KeyHandler::getNextSampleBuffer(float * buffer, int frames, const midiMessage * messages, int numMessages) {
+    RealtimeCheck::Scope realtime;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int position = 0;
+    for(int i = 0; i < numMessages; i++) {
+        int time = messages[i].time < (unsigned int) frames ? messages[i].time : frames;
+        // render everything up to the frame of this message
+        if(time > position) {
+            renderFrames(&(buffer[position]), time - position);
+            position = time;
+        }
+        mapMidi(messages[i]);
+    }
+    if(position < frames) {
+        renderFrames(&(buffer[position]), frames - position);
+    }
+    updateLoad(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), frames);
+}
+
+void Midi2KeyHandler::setLoadGovernor(bool enabled, float target, bool shed) {
+    governorEnabled = enabled;
+    targetLoad = target;
+    governorShed = shed;
+    governorHold = 0;
+}
+
+void Midi2KeyHandler::updateLoad(double seconds, int frames) {
+    if(frames <= 0) {
+        return;
+    }
+    float load = seconds * sampleRate / frames;
+    // smoothed over about ten buffers
+    dspLoad = dspLoad + 0.1f * (load - dspLoad);
+    if(!governorEnabled) {
+        return;
+    }
+
+    int numSounding = 0;
+    Key* quietestReleased = NULL;
+    for(int i = 0; i < numActiveKeys; i++) {
+        Key* key = &(keys[activeKeys[i]]);
+        if(key->isFading()) {
+            continue;
+        }
+        numSounding++;
+        if(key->volumeEnvelope.getCurrentStage() == Envelope::ENVELOPE_STAGE_RELEASE &&
+           (!quietestReleased || getKeyLevel(activeKeys[i]) < getKeyLevel(quietestReleased - keys))) {
+            quietestReleased = key;
+        }
+    }
+    // close to an xrun or above the ceiling, do not wait for the next note
+    if(governorShed && quietestReleased && (load > shedLoad || numSounding > polyphony)) {
+        unloadKey(quietestReleased - keys);
+        quietestReleased->fadeOut();
+    }
+
+    if(governorHold > 0) {
+        governorHold--;
+        return;
+    }
+    int ceiling = polyphony;
+    if(dspLoad > targetLoad && ceiling > minGovernorPolyphony) {
+        // the keys that fit into the target, at least one less than now
+        int fit = numSounding * targetLoad / dspLoad;
+        ceiling = fit < ceiling - 1 ? fit : ceiling - 1;
+        if(ceiling < minGovernorPolyphony) {
+            ceiling = minGovernorPolyphony;
+        }
+    } else if(dspLoad < 0.75f * targetLoad && ceiling < maxPolyphony) {
+        ceiling++;
+    } else {
+        return;
+    }
+    polyphony = ceiling;
+    governorHold = governorHoldBuffers;
+}
+
+void Midi2KeyHandler::renderFrames(float * buffer, int frames) {
+    int numThreads = workerPool->getNumThreads();
+    for(int offset = 0; offset < frames; offset += chunkFrames) {
+        // gliding controllers are updated every Key::maxBlockSize samples
+        int chunkSize = parametersSmoothing() ? Key::maxBlockSize : maxChunkSize;
+        chunkFrames = frames - offset < chunkSize ? frames - offset : chunkSize;
+        updateParameters(chunkFrames);
+        float * chunk = &(buffer[offset]);
+        for(int j = 0; j < chunkFrames; j++) {
+            cutOffLFOBuffer[j] = cutOffLFO->getNextSample();
         }
+        // hand out the keys in groups of four, so every worker can use the SIMD filters
+        int numGroups = (numActiveKeys + 3) / 4;
+        int begin = 0;
+        for(int w = 0; w < numThreads; w++) {
+            partitionBegin[w] = begin;
+            begin += 4 * (numGroups / numThreads + (w < numGroups % numThreads ? 1 : 0));
+            if(begin > numActiveKeys)
+                begin = numActiveKeys;
+        }
+        partitionBegin[numThreads] = numActiveKeys;
+
+        workerPool->run(renderPartitionJob, this);
 
-        buffer[j] *= globalLFO->getNextSample()+1.0;
+        // join the partial buses in a fixed order, the result does not depend on thread timing
+        for(int j = 0; j < chunkFrames; j++) {
+            chunk[j] = partialBuses[0][j];
+        }
+        for(int w = 1; w < numThreads; w++) {
+            for(int j = 0; j < chunkFrames; j++) {
+                chunk[j] += partialBuses[w][j];
+            }
+        }
+        for (int i = 0; i < numActiveKeys; ) {
+            if(keys[activeKeys[i]].stillActive()) {
+                i++;
+            } else {
+                // key is free again, its next note starts from the filter state it ended with
+                unloadKey(activeKeys[i]);
+                // fill the gap with the last active key, which leaves its slot
+                int moved = activeKeys[--numActiveKeys];
+                if(i < numActiveKeys) {
+                    unloadKey(moved);
+                    activeKeys[i] = moved;
+                }
+            }
+        }
+        for(int j = 0; j < chunkFrames; j++) {
+            chunk[j] *= globalLFO->getNextSample()+1.0;
+        }
     }
 }
 
+void Midi2KeyHandler::renderPartitionJob(void * handler, int worker) {
+    RealtimeCheck::Scope realtime;
+    static_cast<Midi2KeyHandler*>(handler)->renderPartition(worker);
+}
+
+void Midi2KeyHandler::renderPartition(int worker) {
+    float * bus = partialBuses[worker];
+    for(int j = 0; j < chunkFrames; j++) {
+        bus[j] = 0.0;
+    }
+    int begin = partitionBegin[worker];
+    int end = partitionBegin[worker+1];
+    // the last group is filled up with silent lanes
+    int groupEnd = end > begin ? (end + 3) & ~3 : begin;
+    bool sounding[VoicePool::capacity]; ///< false once the key of a slot has finished
+    for(int slot = begin; slot < groupEnd; slot++) {
+        sounding[slot] = slot < end;
+        if(sounding[slot]) {
+            int k = activeKeys[slot];
+            if(poolSlot[k] == slot) {
+                // the pool already owns the state, only resonance and filter type may have changed
+                if(keys[k].applyPatch()) {
+                    voicePool.loadParameters(slot, keys[k]);
+                }
+            } else {
+                // patch first, the pool loads the resonance
+                keys[k].applyPatch();
+                voicePool.load(slot, keys[k]);
+                poolSlot[k] = slot;
+            }
+        } else {
+            voicePool.clear(slot);
+        }
+    }
+    float envelopeBuffers[2][4][Key::maxBlockSize]; ///< volume and filter envelope of the four lanes
+    for(int offset = 0; offset < chunkFrames; offset += Key::maxBlockSize) {
+        int blockSize = chunkFrames - offset < Key::maxBlockSize ? chunkFrames - offset : Key::maxBlockSize;
+        for (int first = begin; first < groupEnd; first += 4) {
+            if(!(sounding[first] || sounding[first+1] || sounding[first+2] || sounding[first+3])) {
+                continue;
+            }
+            Key * group[4];
+            float * volume[4];
+            float * filter[4];
+            float * voices[4];
+            const float * g[4];
+            for (int v = 0; v < 4; v++) {
+                group[v] = sounding[first+v] ? &(keys[activeKeys[first+v]]) : NULL;
+                volume[v] = envelopeBuffers[0][v];
+                filter[v] = envelopeBuffers[1][v];
+                voices[v] = voiceBuffers[first+v];
+                g[v] = gBuffers[first+v];
+            }
+            voicePool.renderEnvelopes4(first, group, volume, filter, blockSize);
+            for (int v = 0; v < 4; v++) {
+                if(group[v]) {
+                    group[v]->renderVoice(voices[v], gBuffers[first+v], &(cutOffLFOBuffer[offset]), volume[v], filter[v], blockSize);
+                } else {
+                    // silent lane, the filter keeps its last coefficient
+                    float lastG = voicePool.getG(first+v);
+                    for(int j = 0; j < blockSize; j++) {
+                        voices[v][j] = 0.0;
+                        gBuffers[first+v][j] = lastG;
+                    }
+                }
+            }
+            voicePool.renderFilters4(first, voices, g, blockSize);
+            for (int v = 0; v < 4; v++) {
+                if(!group[v]) {
+                    continue;
+                }
+                float peak = 0.0;
+                for(int j = 0; j < blockSize; j++) {
+                    bus[offset+j] += voices[v][j];
+                    float magnitude = voices[v][j] < 0 ? -voices[v][j] : voices[v][j];
+                    peak = magnitude > peak ? magnitude : peak;
+                }
+                // the oscillators can not get louder than the envelope, the filter may still ring,
+                // so both have to be inaudible before a released key is cut short
+                if(group[v]->isReleased() && peak < silenceThreshold &&
+                   volume[v][blockSize-1] * group[v]->_velocity / 127.0 < silenceThreshold) {
+                    group[v]->retire();
+                }
+                if(!group[v]->stillActive()) {
+                    // finished keys are not rendered any more, they leave activeKeys after the join
+                    sounding[first+v] = false;
+                    voicePool.silence(first+v);
+                }
+            }
+        }
+    }
+    // the state stays in the pool for the next chunk, see unloadKey()
+}
@@ -7,6 +7,9 @@
  * Messages from the midiMan-class are managed and changes in parameters are set in all keys. 
  * This class holds an array of keys and keeps track on pressed/released keys. 
  * Volume LFO and Cut-off LFO are applied on this level.
+ * The voices can be rendered on several cores, see WorkerPool.
+ * An optional load governor adapts the polyphony to the measured DSP load.
+ * Released keys are retired as soon as they have become inaudible, see setSilenceThreshold().
  *
  * \author $Author: Corvin Jaedicke & Alberto Monciero $
  *
@@ -25,8 +28,14 @@
 #include <cstdlib>
 #include <stdlib.h>
 #include <cmath>
-#include "midiman.h"
+#include <atomic>
+#include "datatypes.h"
 #include "key.h"
+#include "workerPool.h"
+#include "voicePool.h"
+#include "realtimeCheck.h"
+#include "parameterSmoother.h"
+#include "patch.h"
 
 using std::cout;
 using std::endl;
@@ -34,20 +43,62 @@ using std::endl;
 class Midi2KeyHandler
 {
 public:
-	/// Midi-Key-Handler with default parameters applied
-    Midi2KeyHandler() :
+    /// Which key is stolen when all voices are in use
+    enum StealPolicy {
+        STEAL_OLDEST = 0, ///< The key that was pressed first
+        STEAL_QUIETEST, ///< The key with the lowest volume envelope level
+        STEAL_SAME_NOTE, ///< A key playing the same note is always retriggered, otherwise STEAL_RELEASED_FIRST
+        STEAL_RELEASED_FIRST ///< The oldest key in its release stage, otherwise STEAL_OLDEST
+    };
+
+	/** 
+     * \brief Midi-Key-Handler with default parameters applied
+     * \param fs Sample rate of the audio server
+     * \param numThreads Number of cores rendering voices, including the calling thread
+     * \param rtPriority SCHED_FIFO priority of the extra threads, 0 for normal scheduling
+     */
+    Midi2KeyHandler(int fs = 48000, int numThreads = 1, int rtPriority = 0) :
     alpha(0.5),
     beta(0.5),
     gamma(0.5), 
+    sampleRate(fs),
     holdOn(false),
     maxCutOff(10000.0),
-    cutOff(10000.0) {
-        globalLFO = new WaveGen( 0, 1, 0,  48000, SINUS);
-        cutOffLFO = new WaveGen( 0, 0.5, 0,  48000, SINUS);
+    cutOff(10000.0),
+    alphaSmoother(0.5, defaultSmoothingTime, fs),
+    gammaSmoother(0.5, defaultSmoothingTime, fs),
+    cutOffSmoother(10000.0, defaultSmoothingTime, fs),
+    resonanceSmoother(1.0, defaultSmoothingTime, fs),
+    stealPolicy(STEAL_RELEASED_FIRST),
+    polyphony(maxPolyphony),
+    governorEnabled(false),
+    governorShed(true),
+    targetLoad(0.7),
+    dspLoad(0.0),
+    governorHold(0),
+    silenceThreshold(0.001),
+    noteCounter(0),
+    numActiveKeys(0) {
+        globalLFO = new WaveGen( 0, 1, 0,  sampleRate, SINUS);
+        cutOffLFO = new WaveGen( 0, 0.5, 0,  sampleRate, SINUS);
+        workerPool = new WorkerPool(numThreads, rtPriority);
         for(int i = 0; i < numberOfKeys; i++) {
+            keys[i].setSampleRate(sampleRate);
             keys[i].setCutOff(cutOff);
+            keys[i].setPatch(&patch);
+            poolSlot[i] = -1;
         }
     };
+    /// Stops the worker threads.
+    ~Midi2KeyHandler() {
+        delete workerPool;
+        delete globalLFO;
+        delete cutOffLFO;
+    };
+    /// Cache-line aligned allocation, new of C++11 does not honour the alignment of the members.
+    static void * operator new(size_t size);
+    /// Frees memory of operator new().
+    static void operator delete(void * pointer);
 
     /**
    	 * \brief Processes incoming midi messages.
@@ -56,8 +107,11 @@ public:
    	 * This method maps incoming midi messages to their corresponding 
    	 * parameters and keys. This method is optimized for input from the cme Mobiltone U-Key 
    	 * (Keyboad Controller) and M-Audio Trigger Finger (Pad).
+   	 * Wave mix, cut-off and resonance only get a new target, the keys follow it
+   	 * smoothly (see setSmoothingTime()). Sound parameters are written to the shared
+   	 * Patch once, the keys copy them before their next chunk.
    	 */
-    void mapMidi(MidiMan::midiMessage m);
+    void mapMidi(midiMessage m);
 
     /**
    	 * \brief Activates a new key in the key-array
@@ -65,7 +119,9 @@ public:
    	 * \param velocity The velocity applied to the key
    	 * \param frequency The frequency corresponding to this key number
    	 * 
-   	 * If no key is available nothing happens, change numberOfKeys to get more keys.
+   	 * If the polyphony is used up, a key is stolen according to the steal policy.
+   	 * The stolen key fades out within a few milliseconds while the new note starts on a spare key,
+   	 * so no note is dropped and nothing clicks.
    	 */
     void onKeyPressed(int keyNumber, float velocity, float frequency);
     /**
@@ -81,11 +137,112 @@ public:
    	 * \param buffer Pointer to the audio-buffer
    	 * \param frames Size of the buffer
    	 * 
-   	 * Iterates through all keys and adds up the new sample value.
-   	 * Volume LFO is applied in a last step.
-   	 * Cut-off LFO is handed to each key.
+   	 * The buffer is rendered in chunks of up to maxChunkSize samples.
+   	 * For each chunk the cut-off LFO is rendered into a control buffer and the active keys
+   	 * are split between the worker threads in groups of four. Every worker renders its keys
+   	 * in blocks of Key::maxBlockSize samples (envelopes and filters four keys at a time on
+   	 * SIMD lanes, out of the VoicePool) into its own partial bus. After all workers are done, the partial buses are added up
+   	 * in a fixed order and the Volume LFO is applied in a last step.
+   	 * Keys that finished their envelope cycle are removed from the active-key list.
+   	 * 
+   	 * Realtime safe: no allocation, no locks, no syscalls besides waking the workers.
+   	 * The caller and the workers run in a RealtimeCheck::Scope.
    	 */
     void getNextSampleBuffer(float* buffer, int frames);
+    /**
+   	 * \brief Fills the audio-out buffer and applies midi messages sample-accurate.
+   	 * \param buffer Pointer to the audio-buffer
+   	 * \param frames Size of the buffer
+   	 * \param messages Midi messages of this buffer, sorted by their time (frame offset)
+   	 * \param numMessages Number of midi messages
+   	 * 
+   	 * The buffer is split at the frame offset of every message,
+   	 * each message is applied with mapMidi() right before its frame is rendered.
+   	 */
+    void getNextSampleBuffer(float* buffer, int frames, const midiMessage * messages, int numMessages);
+    /**
+   	 * \brief Set new sample rate for all keys and LFOs.
+   	 * \param fs Sample rate in Hz
+   	 * 
+   	 * Does not allocate, may be called from the audio thread.
+   	 */
+    void setSampleRate(int fs);
+    /// Get the current sample rate.
+    int getSampleRate() {return sampleRate;}
+    /// Number of cores rendering voices.
+    int getNumThreads() {return workerPool->getNumThreads();}
+    /// Pins the calling thread to the core no render worker uses, once from the audio thread (see WorkerPool::pinCaller()).
+    void pinAudioThread() {workerPool->pinCaller();}
+    /// Set the steal policy.
+    void setStealPolicy(StealPolicy policy) {stealPolicy = policy;}
+    /// Get the steal policy.
+    StealPolicy getStealPolicy() {return stealPolicy;}
+    /**
+   	 * \brief Set the number of keys that may sound at once.
+   	 * \param numKeys Limited to 1..maxPolyphony
+   	 * 
+   	 * Keys fading out after being stolen do not count. Lowering the polyphony does not
+   	 * stop sounding keys, it takes effect with the next note.
+   	 * With the load governor enabled this is only the starting point.
+   	 */
+    void setPolyphony(int numKeys) {polyphony = numKeys < 1 ? 1 : (numKeys > maxPolyphony ? maxPolyphony : numKeys);}
+    /// Get the number of keys that may sound at once (current ceiling of the load governor), safe from any thread.
+    int getPolyphony() {return polyphony;}
+    /**
+   	 * \brief Enables the load governor.
+   	 * \param enabled Turns the governor on or off
+   	 * \param target DSP load to hold, time per buffer over buffer length (0..1)
+   	 * \param shed If true released keys are faded out, see below
+   	 * 
+   	 * Every call of getNextSampleBuffer() is timed against the length of the buffer.
+   	 * If the smoothed load is above target the polyphony is lowered towards the number
+   	 * of keys that fit, if it is well below target the polyphony grows again one key at a time.
+   	 * With shed, the quietest released key is faded out after every buffer that is above
+   	 * shedLoad or that had more sounding keys than the polyphony allows.
+   	 * Otherwise keys above the polyphony are only stolen by the next notes.
+   	 */
+    void setLoadGovernor(bool enabled, float target = 0.7, bool shed = true);
+    /// Smoothed DSP load of the last buffers (0..1, above 1 is an xrun), safe from any thread.
+    float getDspLoad() {return dspLoad;}
+    /**
+   	 * \brief Set the level below which released keys are retired.
+   	 * \param level Linear amplitude, 0.001 (-60 dB) by default, 0 lets every release run to its end
+   	 * 
+   	 * After every block a released key whose volume envelope (times velocity) and filtered
+   	 * output both stayed below level is switched off, so it stops using CPU and its key is free again
+   	 * long before the release time is over.
+   	 */
+    void setSilenceThreshold(float level) {silenceThreshold = level;}
+    /// Get the level below which released keys are retired.
+    float getSilenceThreshold() {return silenceThreshold;}
+    /**
+   	 * \brief Set the tanh implementation of the filter saturation of all keys.
+   	 * \param mode See Saturation, SATURATION_PADE by default
+   	 * 
+   	 * Trades accuracy for voices on small boards. Not thread-safe, call it between buffers.
+   	 */
+    void setSaturation(Saturation::Mode mode);
+    /**
+   	 * \brief Oversample the filters of all keys against aliasing at high resonance.
+   	 * \param factor 1 (off, default), 2 or 4
+   	 * 
+   	 * Costs about factor times the filter time plus the half-band filters, see Oversampler.
+   	 * Not thread-safe, call it between buffers.
+   	 */
+    void setOversampling(int factor);
+    /**
+   	 * \brief Set the glide time of wave mix, cut-off and resonance.
+   	 * \param seconds Time constant of the ParameterSmoother, 0 applies controllers at once
+   	 * 
+   	 * While a parameter glides, the buffer is rendered in chunks of Key::maxBlockSize samples
+   	 * and the smoothed values are written to the Patch before every chunk.
+   	 */
+    void setSmoothingTime(float seconds);
+
+    static constexpr float defaultSmoothingTime = 0.02; ///< Glide time of the controllers in seconds
+
+    static const int maxPolyphony = 24; ///< max number of keys that can be active at one time. Including keys that are in release-mode.
+    static const int numberOfFadeKeys = 4; ///< Spare keys, used while stolen keys fade out
 
     // wave mix
     float alpha; ///< Determines the wave-mix of square- and custom-wave.
@@ -93,11 +250,28 @@ public:
     float gamma; ///< Mixes the two wave mixes to one signal.
 
 private:
+    int sampleRate; ///< Sample rate of all keys and LFOs
     WaveGen *globalLFO; ///< Volume LFO
     WaveGen *cutOffLFO; ///< Cut-off LFO
+    WorkerPool *workerPool; ///< Threads rendering the voices
     bool holdOn; ///< Flag, if true alpha, beta and gamme are fixed.
     float maxCutOff; ///< max Cut-off frequency (10kHz)
     float cutOff; //y< Current Cut-off frequency
+    ParameterSmoother alphaSmoother; ///< Smoothed alpha (and beta) of the wave mix
+    ParameterSmoother gammaSmoother; ///< Smoothed gamma of the wave mix
+    ParameterSmoother cutOffSmoother; ///< Smoothed cut-off frequency
+    ParameterSmoother resonanceSmoother; ///< Smoothed filter resonance
+    /// true while any controller has not reached its target.
+    bool parametersSmoothing() const {
+        return alphaSmoother.isSmoothing() || gammaSmoother.isSmoothing() ||
+               cutOffSmoother.isSmoothing() || resonanceSmoother.isSmoothing();
+    }
+    Patch patch; ///< Parameters shared by all keys
+    /**
+   	 * \brief Advances the smoothers by a chunk and writes the values to the patch.
+   	 * \param frames Length of the chunk
+   	 */
+    void updateParameters(int frames);
     const float freq[88] = {27.5000000000000,
                                 29.1353000000000,
                                 30.8677000000000,
@@ -187,12 +361,79 @@ private:
                                 3951.07000000000,
                                 4186.01000000000}; ///< Frequency of the different keys
 
-    static const int numberOfKeys = 24; ///< max number of keys that can be active at one time. Including keys that are in release-mode.
+    StealPolicy stealPolicy; ///< How a key is chosen when the polyphony is used up
+    std::atomic<int> polyphony; ///< Number of keys that may sound at once, without fading keys
+
+    bool governorEnabled; ///< Flag, if true polyphony follows the DSP load
+    bool governorShed; ///< Flag, if true the governor fades out released keys
+    float targetLoad; ///< DSP load the governor holds
+    std::atomic<float> dspLoad; ///< Smoothed DSP load
+    int governorHold; ///< Buffers to wait before the next change of polyphony
+    static const int minGovernorPolyphony = 4; ///< The governor never goes below this
+    static const int governorHoldBuffers = 8; ///< Buffers between two changes, lets dspLoad settle
+    static constexpr float shedLoad = 0.9; ///< Load of a single buffer that sheds a released key
+    float silenceThreshold; ///< Released keys below this level are retired
+    unsigned long noteCounter; ///< Counts the notes, gives the age of a key
+    static const int numberOfKeys = maxPolyphony + numberOfFadeKeys; ///< Size of the key-array
+    unsigned long noteOrder[numberOfKeys]; ///< Value of noteCounter when the key was pressed
     Key keys[numberOfKeys]; ///< Array holding all keys
+    int activeKeys[numberOfKeys]; ///< Indices of all keys that are currently sounding, in no particular order
+    int numActiveKeys; ///< Number of valid entries in activeKeys
+    static_assert(numberOfKeys <= VoicePool::capacity, "VoicePool too small");
+    VoicePool voicePool; ///< Render state of the active keys (same order as activeKeys)
+    int poolSlot[numberOfKeys]; ///< Slot in voicePool that owns the render state of a key, -1 if the Key object is up to date
+    alignas(VoicePool::cacheLineSize) float voiceBuffers[VoicePool::capacity][Key::maxBlockSize]; ///< Unfiltered block of every active key (same order as activeKeys)
+    alignas(VoicePool::cacheLineSize) float gBuffers[VoicePool::capacity][Key::maxBlockSize]; ///< Filter coefficients of every active key (same order as activeKeys)
+
+    static const int maxChunkSize = 1024; ///< Samples rendered per run of the worker pool, longer buffers are split
+    float cutOffLFOBuffer[maxChunkSize]; ///< Control buffer of the cut-off LFO for the current chunk
+    alignas(VoicePool::cacheLineSize) float partialBuses[WorkerPool::maxThreads][maxChunkSize]; ///< Sum of the keys of every worker
+    int partitionBegin[WorkerPool::maxThreads+1]; ///< Worker w renders activeKeys[partitionBegin[w]] up to activeKeys[partitionBegin[w+1]-1]
+    int chunkFrames; ///< Length of the current chunk
+    /**
+   	 * \brief Gives the render state of a key back from voicePool.
+   	 * \param k Index of the key in the key-array
+   	 * 
+   	 * Call it before the Key object is changed from outside the render workers.
+   	 * The next chunk loads the key again.
+   	 */
+    void unloadKey(int k);
+    /// unloadKey() for every active key, before settings of all keys change.
+    void unloadAllKeys();
+    /// Level of the volume envelope of a key, taken from voicePool while the pool owns its state.
+    float getKeyLevel(int k) const {return poolSlot[k] >= 0 ? voicePool.getVolumeLevel(poolSlot[k]) : keys[k].volumeEnvelope.getLevel();}
     /**
    	 * \brief Find a free key in the key-array
    	 * \return Pointer to the free key.
    	 */
     Key* findFreeKey();
+    /**
+   	 * \brief Chooses the key to steal according to the steal policy.
+   	 * \param keyNumber Key number of the new note
+   	 * \param force If false, only STEAL_SAME_NOTE may return a key (retrigger while voices are left)
+   	 * \return Index of the key in the key-array or -1
+   	 * 
+   	 * Keys that already fade out are never chosen.
+   	 */
+    int findKeyToSteal(int keyNumber, bool force);
+    /**
+   	 * \brief Renders a part of the audio-buffer without looking at midi messages.
+   	 * \param buffer Pointer to the first sample to render
+   	 * \param frames Number of samples to render
+   	 */
+    void renderFrames(float* buffer, int frames);
+    /**
+   	 * \brief Renders the keys of one worker for the current chunk into its partial bus.
+   	 * \param worker Number of the worker
+   	 */
+    void renderPartition(int worker);
+    /**
+   	 * \brief Updates the DSP load and lets the governor adapt the polyphony.
+   	 * \param seconds Time spent in getNextSampleBuffer()
+   	 * \param frames Length of the buffer
+   	 */
+    void updateLoad(double seconds, int frames);
+    /// WorkerPool::Job calling renderPartition()
+    static void renderPartitionJob(void* handler, int worker);
 
 };
@@ -0,0 +1,206 @@
+#include "midiFileReader.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+
+namespace {
+
+/// Event of a track before the tempo map is applied
+typedef struct {
+    unsigned long tick = 0; ///< Absolute time in ticks
+    int order = 0; ///< Position in the file, keeps simultaneous events in order
+    bool isTempo = false; ///< true for a tempo change, tempo is in microsecondsPerQuarter
+    unsigned long microsecondsPerQuarter = 0;
+    midiMessage message;
+}rawEvent;
+
+bool earlier(const rawEvent& a, const rawEvent& b) {
+    return a.tick < b.tick || (a.tick == b.tick && a.order < b.order);
+}
+
+unsigned long readBigEndian(const unsigned char * p, int nBytes) {
+    unsigned long value = 0;
+    for(int i = 0; i < nBytes; i++)
+        value = (value << 8) | p[i];
+    return value;
+}
+
+/// Channel message with running status resolved, a note-on with velocity zero becomes a note-off.
+midiMessage channelMessage(int status, int data1, int data2) {
+    midiMessage m;
+    m.byte1 = status;
+    m.byte2 = data1;
+    m.byte3 = data2;
+    m.hasBeenProcessed = true;
+    if((status & 0xF0) == 0x90 && data2 == 0)
+        m.byte1 = 0x80 | (status & 0x0F);
+    return m;
+}
+
+/// Reads a variable length quantity, false if the track ends before its last byte.
+bool readVariableLength(const std::vector<unsigned char>& data, size_t& position, size_t end, unsigned long& value) {
+    value = 0;
+    unsigned char byte;
+    do {
+        if(position >= end)
+            return false;
+        byte = data[position++];
+        value = (value << 7) | (byte & 0x7F);
+    } while(byte & 0x80);
+    return true;
+}
+
+}
+
+bool MidiFileReader::fail(const std::string& message)
+{
+    error = message;
+    events.clear();
+    return false;
+}
+
+bool MidiFileReader::loadMidiFile(const std::string& path)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if(!file)
+        return fail("can not open " + path);
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // header chunk
+    if(data.size() < 14 || std::string(data.begin(), data.begin() + 4) != "MThd")
+        return fail(path + " is not a Standard MIDI File");
+    size_t headerLength = readBigEndian(&data[4], 4);
+    int numTracks = readBigEndian(&data[10], 2);
+    unsigned int division = readBigEndian(&data[12], 2);
+    if(division & 0x8000)
+        return fail("SMPTE time division is not supported");
+    if(division == 0)
+        return fail("time division is zero");
+
+    std::vector<rawEvent> rawEvents;
+    size_t position = 8 + headerLength;
+    for(int track = 0; track < numTracks; track++) {
+        if(position + 8 > data.size() || std::string(data.begin() + position, data.begin() + position + 4) != "MTrk")
+            return fail("track chunk missing");
+        size_t end = position + 8 + readBigEndian(&data[position + 4], 4);
+        if(end > data.size())
+            return fail("track chunk truncated");
+        position += 8;
+
+        unsigned long tick = 0;
+        unsigned char status = 0;
+        while(position < end) {
+            // delta time, variable length quantity
+            unsigned long delta;
+            if(!readVariableLength(data, position, end, delta) || position >= end)
+                break;
+            tick += delta;
+
+            if(data[position] & 0x80)
+                status = data[position++];
+            if(status == 0xFF) {
+                // meta event, only tempo is needed
+                if(position >= end)
+                    return fail("meta event truncated");
+                unsigned char type = data[position++];
+                unsigned long length;
+                if(!readVariableLength(data, position, end, length))
+                    return fail("meta event truncated");
+                if(type == 0x51 && length == 3 && position + 3 <= end) {
+                    rawEvent e;
+                    e.tick = tick;
+                    e.order = rawEvents.size();
+                    e.isTempo = true;
+                    e.microsecondsPerQuarter = readBigEndian(&data[position], 3);
+                    rawEvents.push_back(e);
+                }
+                position = length < end - position ? position + length : end;
+                status = 0;
+            } else if(status == 0xF0 || status == 0xF7) {
+                // sysex is skipped
+                unsigned long length;
+                if(!readVariableLength(data, position, end, length))
+                    return fail("sysex event truncated");
+                position = length < end - position ? position + length : end;
+                status = 0;
+            } else if(status >= 0x80) {
+                // channel message, program change and channel pressure have one data byte
+                int nData = ((status & 0xF0) == 0xC0 || (status & 0xF0) == 0xD0) ? 1 : 2;
+                if(position + nData > end)
+                    break;
+                if(nData == 2) {
+                    rawEvent e;
+                    e.tick = tick;
+                    e.order = rawEvents.size();
+                    e.message = channelMessage(status, data[position], data[position + 1]);
+                    rawEvents.push_back(e);
+                }
+                position += nData;
+            } else {
+                return fail("running status without status byte");
+            }
+        }
+        position = end;
+    }
+
+    // merge all tracks and apply the tempo map
+    std::stable_sort(rawEvents.begin(), rawEvents.end(), earlier);
+    events.clear();
+    double seconds = 0.0;
+    double secondsPerTick = 0.5 / division; // 120 bpm until the first tempo event
+    unsigned long lastTick = 0;
+    for(size_t i = 0; i < rawEvents.size(); i++) {
+        seconds += (rawEvents[i].tick - lastTick) * secondsPerTick;
+        lastTick = rawEvents[i].tick;
+        if(rawEvents[i].isTempo) {
+            secondsPerTick = rawEvents[i].microsecondsPerQuarter * 1e-6 / division;
+        } else {
+            timedMessage t;
+            t.seconds = seconds;
+            t.message = rawEvents[i].message;
+            events.push_back(t);
+        }
+    }
+    error.clear();
+    return true;
+}
+
+bool MidiFileReader::loadScript(const std::string& path)
+{
+    std::ifstream file(path.c_str());
+    if(!file)
+        return fail("can not open " + path);
+
+    events.clear();
+    std::string line;
+    int lineNumber = 0;
+    while(std::getline(file, line)) {
+        lineNumber++;
+        std::istringstream fields(line);
+        timedMessage t;
+        int byte1, byte2, byte3;
+        if(!(fields >> t.seconds)) {
+            // empty line or comment
+            continue;
+        }
+        if(!(fields >> byte1 >> byte2 >> byte3)) {
+            std::ostringstream message;
+            message << path << ":" << lineNumber << ": expected time and three bytes";
+            return fail(message.str());
+        }
+        // the same 3-byte channel messages as in a MIDI file
+        if(byte1 < 0x80 || byte1 > 0xEF || byte2 < 0 || byte2 > 0x7F || byte3 < 0 || byte3 > 0x7F) {
+            std::ostringstream message;
+            message << path << ":" << lineNumber << ": expected a channel message (status 128..239, data 0..127)";
+            return fail(message.str());
+        }
+        t.message = channelMessage(byte1, byte2, byte3);
+        events.push_back(t);
+    }
+    std::stable_sort(events.begin(), events.end(),
+                     [](const timedMessage& a, const timedMessage& b) {return a.seconds < b.seconds;});
+    error.clear();
+    return true;
+}
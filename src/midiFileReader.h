@@ -0,0 +1,67 @@
+/**
+ * \class MidiFileReader
+ *
+ *
+ * \brief Reads MIDI events from a Standard MIDI File or a simple event script.
+ *
+ * Used for offline rendering, where the Midi2KeyHandler is driven without
+ * JACK or RtMidi. All tracks are merged and every event gets its time in seconds,
+ * taking tempo changes into account.
+ * Only 3-byte channel messages are kept, the same as for live input.
+ * Note-on messages with velocity zero are turned into note-off messages.
+ *
+ * The event script is a text file with one event per line:
+ * time in seconds followed by the three bytes, e.g. "0.5 144 60 100".
+ * Only channel messages are accepted (status 128..239, data 0..127).
+ * Empty lines and lines starting with '#' are ignored.
+ *
+ * \author $Author: Corvin Jaedicke & Alberto Monciero $
+ *
+ * \version $Revision: 1.5 $
+ *
+ * \date $Date: 2017/29/04 21:14:27 $
+ *
+ * Contact: c.jaedicke@math.tu-berlin.de
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "datatypes.h"
+
+class MidiFileReader
+{
+public:
+    /// A midi message with its time since start of the file
+    typedef struct {
+        double seconds = 0.0; ///< Time since start in seconds
+        midiMessage message; ///< The message, time is not used
+    }timedMessage;
+
+    /**
+     * \brief Reads a Standard MIDI File (format 0 or 1).
+     * \param path Path to the .mid file
+     * \return false if the file could not be read, see getError()
+     */
+    bool loadMidiFile(const std::string& path);
+    /**
+     * \brief Reads an event script.
+     * \param path Path to the text file
+     * \return false if the file could not be read, see getError()
+     */
+    bool loadScript(const std::string& path);
+    /// All events sorted by time.
+    const std::vector<timedMessage>& getEvents() const {return events;}
+    /// Description of the last error.
+    const std::string& getError() const {return error;}
+
+private:
+    std::vector<timedMessage> events; ///< Events sorted by time
+    std::string error; ///< Last error
+
+    /// Sets error and returns false.
+    bool fail(const std::string& message);
+};
@@ -2,13 +2,18 @@
 
 bool MidiMan::done;
 
-MidiMan::MidiMan()
+MidiMan::MidiMan(bool openRtMidiPort) :
+    numMidiMessages(0)
 {
     midiin = new RtMidiIn(RtMidiIn::Api::UNSPECIFIED ,std::string("RtMidi Input Client"),(unsigned int) 100);
     unsigned int nPorts = midiin->getPortCount();
-    midiin->openPort( 0 );
+    // with JACK MIDI the same device must not be opened here too, every event would be applied twice
+    if(openRtMidiPort && nPorts > 0)
+        midiin->openPort( 0 );
     // Ignore sysex, timing, or active sensing messages.
     midiin->ignoreTypes( true, true, true );
+    // messages are pushed into midiQueue from the RtMidi thread
+    midiin->setCallback( &MidiMan::mycallback, this );
     done = false;
 }
 
@@ -20,26 +25,64 @@ void MidiMan::setVerbose()
 
 }
 
-MidiMan::midiMessage MidiMan::get_rtmidi()
+void MidiMan::mycallback( double deltatime, std::vector< unsigned char > *message, void *userData )
 {
-   	MidiMan::midiMessage mm;
-   	std::vector<unsigned char>  a;
-   	midiin->getMessage(&a);
-    int nBytes = a.size();
+    MidiMan *midiMan = static_cast<MidiMan*>(userData);
+    int nBytes = message->size();
 
     // only do something if 3 bytes are received
     if(nBytes == 3) {
     // only give feedback if 'verbose-mode' is active
-        if( isVerbose == true  ) {
+        if( midiMan->isVerbose == true  ) {
             for (int i=0; i<nBytes; i++ )
-                std::cout << std::dec << (int)a[i] << " | " ;
+                std::cout << std::dec << (int)(*message)[i] << " | " ;
                 std::cout <<  std::endl;
         }
-        mm.byte1 = a[0];
-        mm.byte2 = a[1];
-        mm.byte3 = a[2];
+        MidiMan::midiMessage mm;
+        mm.byte1 = (*message)[0];
+        mm.byte2 = (*message)[1];
+        mm.byte3 = (*message)[2];
         mm.hasBeenProcessed = true;
+        // message is dropped if the audio thread falls behind
+        midiMan->midiQueue.push(mm);
+    }
+}
+
+void MidiMan::updateMidiMessages(void *port_buf)
+{
+    numMidiMessages = 0;
+
+    // RtMidi has no timing information inside the period, start of period
+    MidiMan::midiMessage mm;
+    while(numMidiMessages < maxMidiMessages && midiQueue.pop(mm)) {
+        mm.time = 0;
+        midiMessages[numMidiMessages++] = mm;
     }
+
+    if(port_buf == NULL)
+        return;
+
+    // JACK delivers the events sorted by their frame offset
+    jack_nframes_t nEvents = jack_midi_get_event_count(port_buf);
+    jack_midi_event_t event;
+    for(jack_nframes_t i = 0; i < nEvents && numMidiMessages < maxMidiMessages; i++) {
+        if(jack_midi_event_get(&event, port_buf, i) != 0 || event.size != 3)
+            continue;
+        MidiMan::midiMessage& m = midiMessages[numMidiMessages++];
+        m.byte1 = event.buffer[0];
+        m.byte2 = event.buffer[1];
+        m.byte3 = event.buffer[2];
+        m.hasBeenProcessed = true;
+        m.time = event.time;
+    }
+}
+
+MidiMan::midiMessage MidiMan::get_rtmidi()
+{
+   	MidiMan::midiMessage mm;
+   	if(!midiQueue.pop(mm)) {
+   	    mm.hasBeenProcessed = false;
+   	}
     return mm;
 }
 
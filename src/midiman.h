@@ -29,6 +29,7 @@
 #include <rtmidi/RtMidi.h>
 
 #include "datatypes.h"
+#include "spscQueue.h"
 
 
 
@@ -39,20 +40,32 @@ class MidiMan
 
 public:
 
-    typedef struct  {
-        int byte1		  	  = -1;
-        int byte2             = -1;
-        double byte3          = -1;
-        bool hasBeenProcessed = false;
+    typedef ::midiMessage midiMessage; ///< see datatypes.h
 
-    }midiMessage;
-
-    MidiMan();
+    /**
+     * \brief Create the MIDI manager.
+     * \param openRtMidiPort Open the first RtMidi (ALSA) port, false if the
+     * messages arrive through a JACK MIDI port instead
+     */
+    MidiMan(bool openRtMidiPort = true);
     ~MidiMan();
 
     std::vector<std::string> returnAllNames();
 
+    /**
+     * \brief Collect all MIDI messages for the current period.
+     * \param port_buf Buffer of the JACK MIDI input port, may be NULL
+     *
+     * Drains the RtMidi queue first (these messages are applied at frame 0),
+     * then appends all 3-byte events of the JACK MIDI port with their frame offset.
+     * The result is sorted by time and can be read with getMidiMessages().
+     * Does not allocate, safe to call from the audio thread.
+     */
     void updateMidiMessages(void *port_buf);
+    /// Messages collected by the last call of updateMidiMessages().
+    const midiMessage * getMidiMessages() const {return midiMessages;}
+    /// Number of messages collected by the last call of updateMidiMessages().
+    int getNumMidiMessages() const {return numMidiMessages;}
     void parseMidiMessages();
 
     void addNoteOnMessage(int in[3]);
@@ -78,8 +91,16 @@ public:
 
     static void finish(int ignore);
 
+    /**
+     * \brief Get the next message received by RtMidi.
+     * \return The message, hasBeenProcessed is false if no message is waiting
+     *
+     * Takes the message from the lock-free queue filled by mycallback(),
+     * it is safe to call this from the audio thread.
+     */
     midiMessage get_rtmidi();
 
+    /// Print every message in mycallback(), on the RtMidi thread and never on the audio thread.
     void setVerbose();
 
 
@@ -87,6 +108,11 @@ public:
 private:
     static bool done;
     RtMidiIn *midiin;
+    static const unsigned int midiQueueSize = 256; ///< Capacity of the MIDI queue (power of two)
+    SpscQueue<midiMessage, midiQueueSize> midiQueue; ///< Messages from the RtMidi thread, drained by the audio thread
+    static const int maxMidiMessages = 512; ///< max number of messages handled in one period
+    midiMessage midiMessages[maxMidiMessages]; ///< Messages of the current period, sorted by time
+    int numMidiMessages; ///< Number of valid entries in midiMessages
     int nBytes, i;
     double stamp;
     bool isVerbose = false;
@@ -95,6 +121,14 @@ private:
 
     noteMessage *tmpNote;
 
-    void mycallback( double deltatime, std::vector< unsigned char > *message, void *userData );
+    /**
+     * \brief RtMidi callback, runs in the RtMidi thread.
+     * \param deltatime Time since last message
+     * \param message Raw bytes of the message
+     * \param userData Pointer to the MidiMan
+     *
+     * Pushes complete 3-byte messages into midiQueue.
+     */
+    static void mycallback( double deltatime, std::vector< unsigned char > *message, void *userData );
 };
 
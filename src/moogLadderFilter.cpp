@@ -1,5 +1,133 @@
 #include "moogLadderFilter.h"
+#include "simd.h"
 
+namespace {
+
+/// State and parameters of four ladder filters, one voice per SIMD lane.
+struct LadderLanes
+{
+	simd::float4 K;    ///< resonance
+	simd::float4 gain; ///< passband gain compensation 1 + K
+	simd::float4 A, B, C, D, E; ///< Oberheim Xpander coefficients
+	simd::float4 z1, z2, z3, z4; ///< z-1 memory of the four one-pole stages
+
+	/// One sample of all four voices, same math as MoogLadderFilter::tick() after setG(G).
+	template <Saturation::Mode mode>
+	inline simd::float4 tick(simd::float4 xn, simd::float4 G)
+	{
+		using namespace simd;
+		const float4 one = set1(1.0f);
+		// coefficients, all derived from G
+		float4 beta4 = sub(one, G);
+		float4 beta3 = mul(G, beta4);
+		float4 beta2 = mul(G, beta3);
+		float4 beta1 = mul(G, beta2);
+		float4 G2 = mul(G, G);
+		float4 alpha0 = div(one, madd(K, mul(G2, G2), one));
+
+		float4 sigma = madd(beta1, z1, madd(beta2, z2, madd(beta3, z3, mul(beta4, z4))));
+		// input to first filter with saturation compensation
+		float4 u = Saturation::process4<mode>(mul(sub(mul(xn, gain), mul(K, sigma)), alpha0));
+
+		// cascade of 4 filters
+		float4 v = mul(sub(u, z1), G);
+		float4 lp1 = add(v, z1);
+		z1 = add(v, lp1);
+		v = mul(sub(lp1, z2), G);
+		float4 lp2 = add(v, z2);
+		z2 = add(v, lp2);
+		v = mul(sub(lp2, z3), G);
+		float4 lp3 = add(v, z3);
+		z3 = add(v, lp3);
+		v = mul(sub(lp3, z4), G);
+		float4 lp4 = add(v, z4);
+		z4 = add(v, lp4);
+
+		// Oberheim variations
+		return madd(A, u, madd(B, lp1, madd(C, lp2, madd(D, lp3, mul(E, lp4)))));
+	}
+
+	/// Filters a block of the four voices, the saturation is fixed at compile time.
+	template <Saturation::Mode mode>
+	void render(float * pBuffers[4], const float * pG[4], int nFrames)
+	{
+		using namespace simd;
+		int i = 0;
+		// four samples at a time, transposed from per-voice to per-sample vectors
+		for(; i + 4 <= nFrames; i += 4) {
+			float4 x0 = load(&pBuffers[0][i]);
+			float4 x1 = load(&pBuffers[1][i]);
+			float4 x2 = load(&pBuffers[2][i]);
+			float4 x3 = load(&pBuffers[3][i]);
+			float4 g0 = load(&pG[0][i]);
+			float4 g1 = load(&pG[1][i]);
+			float4 g2 = load(&pG[2][i]);
+			float4 g3 = load(&pG[3][i]);
+			transpose(x0, x1, x2, x3);
+			transpose(g0, g1, g2, g3);
+			x0 = tick<mode>(x0, g0);
+			x1 = tick<mode>(x1, g1);
+			x2 = tick<mode>(x2, g2);
+			x3 = tick<mode>(x3, g3);
+			transpose(x0, x1, x2, x3);
+			store(&pBuffers[0][i], x0);
+			store(&pBuffers[1][i], x1);
+			store(&pBuffers[2][i], x2);
+			store(&pBuffers[3][i], x3);
+		}
+		// remaining samples one at a time
+		for(; i < nFrames; i++) {
+			float x[4], g[4];
+			for(int v = 0; v < 4; v++) {
+				x[v] = pBuffers[v][i];
+				g[v] = pG[v][i];
+			}
+			store(x, tick<mode>(load(x), load(g)));
+			for(int v = 0; v < 4; v++) {
+				pBuffers[v][i] = x[v];
+			}
+		}
+	}
+};
+
+/// Renders the lanes with the saturation chosen at runtime.
+inline void renderLanes(LadderLanes & lanes, Saturation::Mode mode, float * pBuffers[4], const float * pG[4], int nFrames)
+{
+	switch(mode)
+	{
+		case Saturation::SATURATION_LIBM:
+			lanes.render<Saturation::SATURATION_LIBM>(pBuffers, pG, nFrames);
+			break;
+		case Saturation::SATURATION_TABLE:
+			lanes.render<Saturation::SATURATION_TABLE>(pBuffers, pG, nFrames);
+			break;
+		case Saturation::SATURATION_BYPASS:
+			lanes.render<Saturation::SATURATION_BYPASS>(pBuffers, pG, nFrames);
+			break;
+		case Saturation::SATURATION_PADE:
+		default:
+			lanes.render<Saturation::SATURATION_PADE>(pBuffers, pG, nFrames);
+			break;
+	}
+}
+
+}
+
+
+float MoogLadderFilter::gTable[MoogLadderFilter::gTableSize+1];
+bool MoogLadderFilter::gTableFilled = MoogLadderFilter::fillGTable();
+
+bool MoogLadderFilter::fillGTable()
+{
+	// entry k belongs to the normalized cut-off frequency k / (2 * gTableSize)
+	for(int k = 0; k < gTableSize; k++) {
+		double g = tan(M_PI * 0.5 * k / gTableSize);
+		gTable[k] = g / (1.0 + g);
+	}
+	// tan() -> infinity at fs/2
+	gTable[gTableSize] = 1.0;
+	return true;
+}
 
 MoogLadderFilter::~MoogLadderFilter()
 {
@@ -14,6 +142,16 @@ void MoogLadderFilter::setCutOff(float Fc) {
 	update();
 }
 
+void MoogLadderFilter::setSampleRate(unsigned int sampleRate) {
+	m_dSampleRate = sampleRate;
+	m_LPF1.m_dSampleRate = sampleRate;
+	m_LPF2.m_dSampleRate = sampleRate;
+	m_LPF3.m_dSampleRate = sampleRate;
+	m_LPF4.m_dSampleRate = sampleRate;
+	calculateTimePerSample();
+	update();
+}
+
 void MoogLadderFilter::reset()
 {
 	// flush everything
@@ -21,6 +159,14 @@ void MoogLadderFilter::reset()
 	m_LPF2.reset();
 	m_LPF3.reset();
 	m_LPF4.reset();
+	oversampler.reset();
+}
+
+void MoogLadderFilter::setOversampling(int factor) {
+	oversampler.setFactor(factor);
+	// the ladder runs at the new rate, same cut-off
+	calculateTimePerSample();
+	update();
 }
 
 
@@ -33,20 +179,39 @@ void MoogLadderFilter::setResonance(float K)
 
 void MoogLadderFilter::update()
 	{
-		float g = tan(M_PI * m_dFc * T);
+		setG(calculateG(m_dFc));
+	}
+
+	float MoogLadderFilter::calculateG(float Fc)
+	{
+		float g = tan(M_PI * Fc * T);
 
 		// feed-forward coeff
 		// same for LPF, HPF
-		float G = g / (1.0 + g);
+		return g / (1.0 + g);
+	}
+
+	float MoogLadderFilter::lookUpG(float Fc)
+	{
+		float position = Fc * T * 2.0f * gTableSize;
+		if(position <= 0.0f)
+			return 0.0f;
+		if(position >= (float) gTableSize)
+			return gTable[gTableSize];
+		int i = (int) position;
+		return gTable[i] + (gTable[i+1] - gTable[i]) * (position - i);
+	}
 
+	void MoogLadderFilter::setG(float G)
+	{
 		// set alphas
 		m_LPF1.m_dAlpha = G;
 		m_LPF2.m_dAlpha = G;
 		m_LPF3.m_dAlpha = G;
 		m_LPF4.m_dAlpha = G;
 
-		// set betas
-		m_LPF4.m_dBeta = 1.0/(1.0 + g);
+		// set betas, 1 - G == 1 / (1 + g)
+		m_LPF4.m_dBeta = 1.0 - G;
 		m_LPF3.m_dBeta = G * m_LPF4.m_dBeta;
 		m_LPF2.m_dBeta = G * m_LPF3.m_dBeta;
 		m_LPF1.m_dBeta = G * m_LPF2.m_dBeta;
@@ -57,6 +222,14 @@ void MoogLadderFilter::update()
 	}
 
 	float MoogLadderFilter::doFilter(float xn)
+	{
+		if(oversampler.getFactor() == 1)
+			return tick(xn);
+		renderOversampled(&xn, NULL, 1);
+		return xn;
+	}
+
+	float MoogLadderFilter::tick(float xn)
 	{
 		float dSigma = m_LPF1.getFeedbackOutput() +
 		 				 m_LPF2.getFeedbackOutput() +
@@ -73,7 +246,7 @@ void MoogLadderFilter::update()
 
 		// saturation compensation
 		// use factor on dU for saturation compensation or let user choose?
-		dU = tanh(dU);
+		dU = Saturation::process(saturation, dU);
 
 		// cascade of 4 filters
 		dLP1 = dU;
@@ -91,34 +264,165 @@ void MoogLadderFilter::update()
 
 	void MoogLadderFilter::doFilter(float * xn)
 	{
-		float dSigma = m_LPF1.getFeedbackOutput() +
-		 				 m_LPF2.getFeedbackOutput() +
-		 				 m_LPF3.getFeedbackOutput() +
-		 				 m_LPF4.getFeedbackOutput();
+		*xn = doFilter(*xn);
+	}
 
-		// passband gain compensation
-		// use factor on m_dK for gain compensation or let user choose?
-		*xn *= 1.0 + m_dK;
+	void MoogLadderFilter::renderBlock(float * pBuffer, int nFrames)
+	{
+		if(oversampler.getFactor() > 1) {
+			renderOversampled(pBuffer, NULL, nFrames);
+			return;
+		}
+		for(int i = 0; i < nFrames; i++) {
+			pBuffer[i] = tick(pBuffer[i]);
+		}
+	}
 
-		// calculate input to first filter
-		*xn = (*xn - m_dK * dSigma) * m_dAlpha_0;
+	void MoogLadderFilter::renderBlock(float * pBuffer, const float * pG, int nFrames)
+	{
+		if(oversampler.getFactor() > 1) {
+			renderOversampled(pBuffer, pG, nFrames);
+			return;
+		}
+		for(int i = 0; i < nFrames; i++) {
+			if(pG[i] != getG())
+				setG(pG[i]);
+			pBuffer[i] = tick(pBuffer[i]);
+		}
+	}
 
-		// saturation compensation
-		// use factor on dU for saturation compensation or let user choose?
-		*xn = tanh(*xn);
-		
-		// cascade of 4 filters
-		dLP1 = *xn;
-		m_LPF1.doFilter(&dLP1);
-		dLP2 = dLP1;
-		m_LPF2.doFilter(&dLP2);
-		dLP3 = dLP2;
-		m_LPF3.doFilter(&dLP3);
-		dLP4 = dLP3;
-		m_LPF4.doFilter(&dLP4);
+	void MoogLadderFilter::renderOversampled(float * pBuffer, const float * pG, int nFrames)
+	{
+		const int factor = oversampler.getFactor();
+		float up[Oversampler::maxBlockSize * Oversampler::maxFactor];
+		for(int i = 0; i < nFrames; i += Oversampler::maxBlockSize) {
+			int n = nFrames - i < Oversampler::maxBlockSize ? nFrames - i : Oversampler::maxBlockSize;
+			oversampler.up(&pBuffer[i], up, n);
+			for(int j = 0; j < n; j++) {
+				if(pG && pG[i+j] != getG())
+					setG(pG[i+j]);
+				for(int k = j * factor; k < (j + 1) * factor; k++) {
+					up[k] = tick(up[k]);
+				}
+			}
+			oversampler.down(up, &pBuffer[i], n);
+		}
+	}
 
-		// Oberheim variations
-		*xn = m_dA * *xn + m_dB*dLP1 + m_dC*dLP2 + m_dD*dLP3 +  m_dE*dLP4;
+	void MoogLadderFilter::renderBlock4(MoogLadderFilter * filters[4], float * pBuffers[4], const float * pG[4], int nFrames)
+	{
+		// gather the four voices into structure-of-arrays form
+		float state[4][4], parameters[numLaneParameters][4];
+		float * pState[4] = {state[0], state[1], state[2], state[3]};
+		float * pParameters[numLaneParameters];
+		for(int p = 0; p < numLaneParameters; p++) {
+			pParameters[p] = parameters[p];
+		}
+		Saturation::Mode mode = Saturation::SATURATION_BYPASS;
+		Oversampler * oversamplers[4];
+		for(int v = 0; v < 4; v++) {
+			filters[v]->getLaneState(pState, pParameters, v);
+			if(filters[v]->saturation < mode)
+				mode = filters[v]->saturation;
+			oversamplers[v] = &filters[v]->oversampler;
+		}
+		renderBlock4(pState, (const float **) pParameters, pBuffers, pG, nFrames, mode, oversamplers);
+
+		// scatter state and last coefficient back to the voices
+		for(int v = 0; v < 4; v++) {
+			MoogLadderFilter * f = filters[v];
+			f->setLaneState(pState, v);
+			if(nFrames > 0 && pG[v][nFrames-1] != f->getG())
+				f->setG(pG[v][nFrames-1]);
+		}
+	}
+
+	void MoogLadderFilter::renderBlock4(float * pState[4], const float * pParameters[numLaneParameters], float * pBuffers[4], const float * pG[4], int nFrames,
+	                                    Saturation::Mode mode, Oversampler * oversamplers[4])
+	{
+		using namespace simd;
+		LadderLanes lanes;
+		lanes.K = load(pParameters[0]);
+		lanes.gain = add(set1(1.0f), lanes.K);
+		lanes.A = load(pParameters[1]);
+		lanes.B = load(pParameters[2]);
+		lanes.C = load(pParameters[3]);
+		lanes.D = load(pParameters[4]);
+		lanes.E = load(pParameters[5]);
+		lanes.z1 = load(pState[0]);
+		lanes.z2 = load(pState[1]);
+		lanes.z3 = load(pState[2]);
+		lanes.z4 = load(pState[3]);
+
+		int factor = 1;
+		for(int v = 0; oversamplers && v < 4; v++) {
+			if(oversamplers[v] && oversamplers[v]->getFactor() > factor)
+				factor = oversamplers[v]->getFactor();
+		}
+
+		if(factor == 1) {
+			renderLanes(lanes, mode, pBuffers, pG, nFrames);
+		} else {
+			// up-sample every lane, run the ladder at the high rate, down-sample again
+			float up[4][Oversampler::maxBlockSize * Oversampler::maxFactor];
+			float gUp[4][Oversampler::maxBlockSize * Oversampler::maxFactor];
+			float * pUp[4] = {up[0], up[1], up[2], up[3]};
+			const float * pGUp[4] = {gUp[0], gUp[1], gUp[2], gUp[3]};
+			for(int i = 0; i < nFrames; i += Oversampler::maxBlockSize) {
+				int n = nFrames - i < Oversampler::maxBlockSize ? nFrames - i : Oversampler::maxBlockSize;
+				for(int v = 0; v < 4; v++) {
+					if(oversamplers[v]) {
+						oversamplers[v]->up(&pBuffers[v][i], up[v], n);
+					} else {
+						for(int k = 0; k < n * factor; k++) {
+							up[v][k] = 0.0;
+						}
+					}
+					for(int j = 0; j < n; j++) {
+						for(int k = j * factor; k < (j + 1) * factor; k++) {
+							gUp[v][k] = pG[v][i+j];
+						}
+					}
+				}
+				renderLanes(lanes, mode, pUp, pGUp, n * factor);
+				for(int v = 0; v < 4; v++) {
+					if(oversamplers[v]) {
+						oversamplers[v]->down(up[v], &pBuffers[v][i], n);
+					} else {
+						for(int j = 0; j < n; j++) {
+							pBuffers[v][i+j] = 0.0;
+						}
+					}
+				}
+			}
+		}
+
+		store(pState[0], lanes.z1);
+		store(pState[1], lanes.z2);
+		store(pState[2], lanes.z3);
+		store(pState[3], lanes.z4);
+	}
+
+	void MoogLadderFilter::getLaneState(float * pState[4], float * pParameters[numLaneParameters], int lane) const
+	{
+		pState[0][lane] = m_LPF1.getState();
+		pState[1][lane] = m_LPF2.getState();
+		pState[2][lane] = m_LPF3.getState();
+		pState[3][lane] = m_LPF4.getState();
+		pParameters[0][lane] = m_dK;
+		pParameters[1][lane] = m_dA;
+		pParameters[2][lane] = m_dB;
+		pParameters[3][lane] = m_dC;
+		pParameters[4][lane] = m_dD;
+		pParameters[5][lane] = m_dE;
+	}
+
+	void MoogLadderFilter::setLaneState(const float * const pState[4], int lane)
+	{
+		m_LPF1.setState(pState[0][lane]);
+		m_LPF2.setState(pState[1][lane]);
+		m_LPF3.setState(pState[2][lane]);
+		m_LPF4.setState(pState[3][lane]);
 	}
 
 	void MoogLadderFilter::setFilter(unsigned int type) {
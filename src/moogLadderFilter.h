@@ -7,6 +7,8 @@
  * This class applies a 4-stage low-pass filter to a sample.
  * The filter is inspired by Moog Ladder Filter with Oberheim Xpander variations as described in:
  * Designing Software Synthesizer Plug-Ins in C++, Page 404, 7.6 Moog Ladder Filter Model
+ * The tanh of the saturation compensation is chosen per filter, see Saturation.
+ * With setOversampling() the ladder runs at 2x or 4x the sample rate, see Oversampler.
  *
  * \author $Author: Corvin Jaedicke & Alberto Monciero $
  *
@@ -27,6 +29,8 @@
 #include <stdlib.h>
 
 #include "filter.h"
+#include "oversampler.h"
+#include "saturation.h"
 
 using std::cout;
 using std::endl;
@@ -48,7 +52,8 @@ public:
 	m_dFc(10000.0),
 	m_dSampleRate(48000),
 	// set default filter type
-	m_uFilterType(LPF4) {
+	m_uFilterType(LPF4),
+	saturation(Saturation::SATURATION_PADE) {
 	// set all as LPF types
 	// this shouldn't be changed!
 	m_LPF1.m_uFilterType = LPF1;
@@ -80,6 +85,21 @@ public:
      * \param K Factor with values between 1..4
      */
 	void setResonance(float K);
+	/// Set the implementation of the saturation tanh (default Saturation::SATURATION_PADE).
+	void setSaturation(Saturation::Mode mode){saturation = mode;}
+	/// Get the implementation of the saturation tanh.
+	Saturation::Mode getSaturation() const {return saturation;}
+	/** 
+     * \brief Run the ladder at a multiple of the sample rate against aliasing of tanh and feedback.
+     * \param factor 1 (off), 2 or 4. This function calls update().
+     *
+     * G (see calculateG() and lookUpG()) belongs to the oversampled rate afterwards.
+     */
+	void setOversampling(int factor);
+	/// Get the oversampling factor.
+	int getOversampling() const {return oversampler.getFactor();}
+	/// Up- and down-sampler of this filter, used by VoicePool to oversample four voices at once.
+	Oversampler * getOversampler(){return &oversampler;}
 	/// Re-calculates alpha value. Only needed after setting resonance.
 	void calculateAlpha_0();
 	// Set Filter type (e.g. LPF, BPF, HPF)
@@ -112,13 +132,41 @@ public:
      */
 	void setCutOff(float Fc);
 	/** 
+     * \brief Set new sample rate. This function calls update().
+     * \param sampleRate Sample rate in Hz
+     */
+	void setSampleRate(unsigned int sampleRate);
+	/** 
      * \brief Updates all parameters used by the filter. This is an very expensive call!
      */
 	void update();
 	/** 
+     * \brief Calculates the feed-forward coefficient G for a cut-off frequency.
+     * \param Fc Cut-off frequency
+     * \return G, all other coefficients can be derived from it
+     */
+	float calculateG(float Fc);
+	/** 
+     * \brief Looks up the feed-forward coefficient G for a cut-off frequency.
+     * \param Fc Cut-off frequency, clamped to 0..fs/2
+     * \return G, linearly interpolated from a table (error < 1e-6)
+     *
+     * Fast replacement for calculateG() without any tan() call, meant for modulation.
+     */
+	float lookUpG(float Fc);
+	/** 
+     * \brief Sets all coefficients from the feed-forward coefficient G.
+     * \param G Feed-forward coefficient as returned by calculateG()
+     */
+	void setG(float G);
+	/// Get the current feed-forward coefficient G.
+	float getG(){return m_LPF1.m_dAlpha;}
+	/** 
      * \brief Applies filter to given sample.
      * \param xn Sample
      * \return Filtered sample
+     *
+     * With oversampling every sample is up- and down-sampled on its own, prefer renderBlock().
      */
 	float doFilter(float xn);
 	/** 
@@ -126,19 +174,90 @@ public:
      * \param xn Pointer to sample
      */
 	void doFilter(float * xn);
+	/** 
+     * \brief Applies filter to a block of samples in place.
+     * \param pBuffer Pointer to the samples
+     * \param nFrames Number of samples
+     */
+	void renderBlock(float * pBuffer, int nFrames);
+	/** 
+     * \brief Applies filter to a block of samples in place with a modulated cut-off.
+     * \param pBuffer Pointer to the samples
+     * \param pG Feed-forward coefficient (see calculateG()) for every sample
+     * \param nFrames Number of samples
+     *
+     * setG() is only called on samples where the coefficient actually changes.
+     */
+	void renderBlock(float * pBuffer, const float * pG, int nFrames);
+	/** 
+     * \brief Applies four filters (voices) at once, one voice per SIMD lane.
+     * \param filters The four filters, their state is loaded and written back
+     * \param pBuffers Samples of every voice, filtered in place
+     * \param pG Feed-forward coefficient of every voice for every sample
+     * \param nFrames Number of samples
+     *
+     * Same as calling renderBlock() on all four filters, but runs the ladder on NEON/SSE lanes.
+     * If the filters use different saturation modes, the most accurate one is used for all lanes.
+     * All four filters have to use the same oversampling factor.
+     */
+	static void renderBlock4(MoogLadderFilter * filters[4], float * pBuffers[4], const float * pG[4], int nFrames);
+
+	static const int numLaneParameters = 6; ///< Parameters of a voice in structure-of-arrays form: K, A, B, C, D, E
+	/** 
+     * \brief Applies four filters (voices) at once, state in structure-of-arrays form.
+     * \param pState z-1 memory of stage 1 to 4, each pointing to the four lanes, updated
+     * \param pParameters K, A, B, C, D and E, each pointing to the four lanes
+     * \param pBuffers Samples of every voice, filtered in place
+     * \param pG Feed-forward coefficient of every voice for every sample
+     * \param nFrames Number of samples
+     * \param mode Saturation of all four lanes
+     * \param oversamplers Up- and down-sampler of every lane or NULL for no oversampling at all,
+     *        all lanes need the same factor, a NULL lane is silent
+     *
+     * Used by VoicePool, where the state of all voices is stored field by field,
+     * so lanes are loaded straight from memory.
+     * With oversampling the ladder runs on the up-sampled lanes, G is held for the added samples.
+     */
+	static void renderBlock4(float * pState[4], const float * pParameters[numLaneParameters], float * pBuffers[4], const float * pG[4], int nFrames,
+	                         Saturation::Mode mode = Saturation::SATURATION_PADE, Oversampler * oversamplers[4] = NULL);
+	/** 
+     * \brief Copies state and parameters into lane of structure-of-arrays storage.
+     * \param pState z-1 memory of stage 1 to 4, indexed by lane
+     * \param pParameters K, A, B, C, D and E, indexed by lane
+     * \param lane Index in the arrays
+     */
+	void getLaneState(float * pState[4], float * pParameters[numLaneParameters], int lane) const;
+	/// Takes the state back from lane of structure-of-arrays storage, see getLaneState().
+	void setLaneState(const float * const pState[4], int lane);
 
 private:
-	float T; ///< 1/sampleRate
+	float T; ///< 1/(sampleRate * oversampling factor)
+	/** 
+     * \brief Calculates the time step per sample of the ladder.
+     * \note Should be re-calculated after changing sampleRate or oversampling
+     */
+	void calculateTimePerSample(){T = 1.0 / ((float) m_dSampleRate * oversampler.getFactor());};
 	/** 
-     * \brief Calculates the time step per sample.
-     * \note Should be re-calculated after changing sampleRate
+     * \brief One sample of the ladder at its own (oversampled) rate.
+     * \param xn Sample
+     * \return Filtered sample
      */
-	void calculateTimePerSample(){T = 1.0 / (float) m_dSampleRate;};
+	float tick(float xn);
+	/// Filters a block at base rate through the oversampler, G is held for the added samples.
+	void renderOversampled(float * pBuffer, const float * pG, int nFrames);
 
 	float dLP1; ///< filter value one
 	float dLP2; ///< filter value two
 	float dLP3; ///< filter value three
 	float dLP4; ///< filter value four
+	Saturation::Mode saturation; ///< Implementation of the saturation tanh
+	Oversampler oversampler; ///< Up- and down-sampling around the ladder, factor 1 by default
+
+	static const int gTableSize = 1024; ///< Resolution of the G table between 0 and fs/2
+	static float gTable[gTableSize+1]; ///< G over normalized cut-off frequency, shared by all filters
+	/// Fills gTable, called once on start-up.
+	static bool fillGTable();
+	static bool gTableFilled; ///< Forces fillGTable() during static initialization
 
 };
 
@@ -0,0 +1,134 @@
+#include "oversampler.h"
+
+#define _USE_MATH_DEFINES
+
+#include <cmath>
+
+float Oversampler::coefficients[Oversampler::taps];
+bool Oversampler::coefficientsFilled = Oversampler::fillCoefficients();
+
+bool Oversampler::fillCoefficients() {
+    // full filter: length 2 * taps - 1, center taps - 1, branch tap i sits at index 2 * i
+    const int length = 2 * taps - 1;
+    const int center = taps - 1;
+    double sum = 0.0;
+    for(int i = 0; i < taps; i++) {
+        int k = 2 * i;
+        // odd distance to the center, sin(pi * d / 2) is +-1
+        int d = k - center;
+        double sinc = sin(M_PI * d / 2.0) / (M_PI * d);
+        double window = 0.42 - 0.5 * cos(2.0 * M_PI * k / (length - 1)) + 0.08 * cos(4.0 * M_PI * k / (length - 1));
+        coefficients[i] = sinc * window;
+        sum += coefficients[i];
+    }
+    // the branch has to add up to 0.5 like the center tap, so DC passes unchanged
+    for(int i = 0; i < taps; i++) {
+        coefficients[i] *= 0.5 / sum;
+    }
+    return true;
+}
+
+void Oversampler::setFactor(int factor) {
+    int f = factor >= 4 ? 4 : (factor >= 2 ? 2 : 1);
+    if(f != this->factor) {
+        this->factor = f;
+        reset();
+    }
+}
+
+void Oversampler::reset() {
+    stages[0].reset();
+    stages[1].reset();
+}
+
+void Oversampler::up(const float * pIn, float * pOut, int nFrames) {
+    if(factor == 1) {
+        for(int i = 0; i < nFrames; i++) {
+            pOut[i] = pIn[i];
+        }
+    } else if(factor == 2) {
+        stages[0].up(pIn, pOut, nFrames);
+    } else {
+        float twice[2 * maxBlockSize];
+        stages[0].up(pIn, twice, nFrames);
+        stages[1].up(twice, pOut, 2 * nFrames);
+    }
+}
+
+void Oversampler::down(const float * pIn, float * pOut, int nFrames) {
+    if(factor == 1) {
+        for(int i = 0; i < nFrames; i++) {
+            pOut[i] = pIn[i];
+        }
+    } else if(factor == 2) {
+        stages[0].down(pIn, pOut, nFrames);
+    } else {
+        float twice[2 * maxBlockSize];
+        stages[1].down(pIn, twice, 2 * nFrames);
+        stages[0].down(twice, pOut, nFrames);
+    }
+}
+
+void Oversampler::HalfBand::reset() {
+    for(int i = 0; i < taps - 1; i++) {
+        upHistory[i] = 0.0;
+        downEvenHistory[i] = 0.0;
+    }
+    for(int i = 0; i < taps / 2; i++) {
+        downOddHistory[i] = 0.0;
+    }
+}
+
+void Oversampler::HalfBand::up(const float * pIn, float * pOut, int nFrames) {
+    // memory followed by the new samples, so the convolution never wraps
+    float x[taps - 1 + maxStageFrames];
+    for(int i = 0; i < taps - 1; i++) {
+        x[i] = upHistory[i];
+    }
+    for(int j = 0; j < nFrames; j++) {
+        x[taps - 1 + j] = pIn[j];
+    }
+    for(int j = 0; j < nFrames; j++) {
+        const float * p = &x[taps - 1 + j];
+        float sum = 0.0;
+        for(int i = 0; i < taps; i++) {
+            sum += coefficients[i] * p[-i];
+        }
+        // gain 2 makes up for the inserted zeros, the center branch (0.5) becomes a plain delay
+        pOut[2 * j] = 2.0f * sum;
+        pOut[2 * j + 1] = p[-(taps / 2 - 1)];
+    }
+    for(int i = 0; i < taps - 1; i++) {
+        upHistory[i] = x[nFrames + i];
+    }
+}
+
+void Oversampler::HalfBand::down(const float * pIn, float * pOut, int nFrames) {
+    float even[taps - 1 + maxStageFrames];
+    float odd[taps / 2 + maxStageFrames];
+    for(int i = 0; i < taps - 1; i++) {
+        even[i] = downEvenHistory[i];
+    }
+    for(int i = 0; i < taps / 2; i++) {
+        odd[i] = downOddHistory[i];
+    }
+    for(int j = 0; j < nFrames; j++) {
+        even[taps - 1 + j] = pIn[2 * j];
+        odd[taps / 2 + j] = pIn[2 * j + 1];
+    }
+    for(int j = 0; j < nFrames; j++) {
+        const float * p = &even[taps - 1 + j];
+        float sum = 0.0;
+        for(int i = 0; i < taps; i++) {
+            sum += coefficients[i] * p[-i];
+        }
+        // odd sample taps / 2 samples back, weighted with the center tap
+        pOut[j] = sum + 0.5f * odd[j];
+    }
+    for(int i = 0; i < taps - 1; i++) {
+        downEvenHistory[i] = even[nFrames + i];
+    }
+    for(int i = 0; i < taps / 2; i++) {
+        downOddHistory[i] = odd[nFrames + i];
+    }
+}
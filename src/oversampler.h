@@ -0,0 +1,91 @@
+/**
+ * \class Oversampler
+ *
+ *
+ * \brief 2x/4x up- and down-sampling with polyphase half-band filters.
+ *
+ * Runs the nonlinear ladder of MoogLadderFilter at a higher rate, so the tanh
+ * and the resonant feedback alias less. One Oversampler belongs to one voice,
+ * up() and down() keep the filter memories between blocks.
+ *
+ * Every octave is one half-band FIR of length 2 * taps - 1 (Blackman window).
+ * All taps at even distance from the center are zero, so the filter splits into
+ * two polyphase branches: one with the taps non-zero coefficients and one that
+ * is only the center tap 0.5, a plain delay. 4x runs two of these stages.
+ * Up- plus down-sampling delays the signal by about (taps - 1) samples of the
+ * rate of the first stage.
+ *
+ * \author $Author: Corvin Jaedicke & Alberto Monciero $
+ *
+ * \version $Revision: 1.5 $
+ *
+ * \date $Date: 2017/29/04 19:14:45 $
+ *
+ * Contact: c.jaedicke@math.tu-berlin.de
+ *
+ */
+
+#pragma once
+
+class Oversampler
+{
+public:
+    static const int maxFactor = 4; ///< Highest oversampling factor
+    static const int maxBlockSize = 64; ///< Maximum nFrames of up() and down()
+    static const int taps = 16; ///< Non-zero taps of the polyphase branch of every half-band filter
+
+    /// Oversampler with factor 1 (no oversampling)
+    Oversampler() : factor(1) {reset();}
+
+    /**
+     * \brief Set the oversampling factor.
+     * \param factor 1, 2 or 4, other values are rounded down to one of them
+     *
+     * Clears the filter memories if the factor changes.
+     */
+    void setFactor(int factor);
+    /// Get the oversampling factor.
+    int getFactor() const {return factor;}
+    /// Clears the filter memories.
+    void reset();
+
+    /**
+     * \brief Up-samples a block.
+     * \param pIn nFrames samples at base rate
+     * \param pOut nFrames * getFactor() samples at the high rate
+     * \param nFrames Number of samples at base rate, <= maxBlockSize
+     */
+    void up(const float * pIn, float * pOut, int nFrames);
+    /**
+     * \brief Down-samples a block.
+     * \param pIn nFrames * getFactor() samples at the high rate
+     * \param pOut nFrames samples at base rate
+     * \param nFrames Number of samples at base rate, <= maxBlockSize
+     */
+    void down(const float * pIn, float * pOut, int nFrames);
+
+private:
+    static const int maxStageFrames = maxBlockSize * maxFactor / 2; ///< Longest input of one half-band stage
+
+    /// Memories of one octave
+    struct HalfBand
+    {
+        float upHistory[taps-1]; ///< Last inputs of the up-sampler
+        float downEvenHistory[taps-1]; ///< Last even inputs of the down-sampler
+        float downOddHistory[taps/2]; ///< Last odd inputs of the down-sampler (delay branch)
+        /// Clears all memories.
+        void reset();
+        /// nFrames samples in, 2 * nFrames samples out
+        void up(const float * pIn, float * pOut, int nFrames);
+        /// 2 * nFrames samples in, nFrames samples out
+        void down(const float * pIn, float * pOut, int nFrames);
+    };
+
+    int factor; ///< Oversampling factor
+    HalfBand stages[2]; ///< Base rate to 2x and 2x to 4x
+
+    static float coefficients[taps]; ///< Polyphase branch of the half-band filter, shared by all stages
+    /// Fills coefficients, called once on start-up.
+    static bool fillCoefficients();
+    static bool coefficientsFilled; ///< Forces fillCoefficients() during static initialization
+};
@@ -0,0 +1,36 @@
+#include "parameterSmoother.h"
+
+#include <cmath>
+
+ParameterSmoother::ParameterSmoother(float value, float time, int sampleRate) :
+    value(value),
+    target(value),
+    time(time),
+    sampleRate(sampleRate),
+    blockFrames(0),
+    blockCoefficient(1.0) {
+}
+
+void ParameterSmoother::setSampleRate(int sampleRate) {
+    this->sampleRate = sampleRate;
+    blockFrames = 0;
+}
+
+void ParameterSmoother::setTime(float time) {
+    this->time = time;
+    blockFrames = 0;
+}
+
+float ParameterSmoother::process(int nFrames) {
+    if(value == target)
+        return value;
+    if(nFrames != blockFrames) {
+        blockFrames = nFrames;
+        // nFrames steps of a one-pole filter at once
+        blockCoefficient = time > 0.0 ? 1.0 - exp(-nFrames / (time * sampleRate)) : 1.0;
+    }
+    value += (target - value) * blockCoefficient;
+    if(fabs(target - value) <= 1e-5f * (1.0f + fabs(target)))
+        value = target;
+    return value;
+}
@@ -0,0 +1,65 @@
+/**
+ * \class ParameterSmoother
+ *
+ *
+ * \brief One-pole smoothing of a MIDI-controlled parameter at control rate.
+ *
+ * A controller only sets the target, the value follows it with the smoothing time
+ * as time constant. process() advances the value by a whole block at once, the
+ * coefficient for a block length is only recalculated if the length changes.
+ * Once the value is within a relative 1e-5 of the target it snaps to it, so a
+ * settled smoother costs nothing.
+ *
+ * \author $Author: Corvin Jaedicke & Alberto Monciero $
+ *
+ * \version $Revision: 1.5 $
+ *
+ * \date $Date: 2017/29/04 21:14:27 $
+ *
+ * Contact: c.jaedicke@math.tu-berlin.de
+ *
+ */
+
+#pragma once
+
+class ParameterSmoother
+{
+public:
+    /**
+     * \brief Smoother resting at a value.
+     * \param value Start value and target
+     * \param time Time constant in seconds, 0 jumps to the target
+     * \param sampleRate Sample rate in Hz
+     */
+    ParameterSmoother(float value = 0.0, float time = 0.02, int sampleRate = 48000);
+
+    /// Set the sample rate in Hz.
+    void setSampleRate(int sampleRate);
+    /// Set the time constant in seconds, 0 jumps to the target.
+    void setTime(float time);
+    /// New target, reached smoothly by process().
+    void setTarget(float target){this->target = target;}
+    /// Jump to a value without smoothing.
+    void setValue(float value){this->value = value; target = value;}
+    /// Get the target.
+    float getTarget() const {return target;}
+    /// Get the current value.
+    float getValue() const {return value;}
+    /// true while the value has not reached the target.
+    bool isSmoothing() const {return value != target;}
+
+    /**
+     * \brief Advances the value by a block.
+     * \param nFrames Length of the block in samples
+     * \return Value at the end of the block
+     */
+    float process(int nFrames);
+
+private:
+    float value; ///< Current value
+    float target; ///< Value set by the controller
+    float time; ///< Time constant in seconds
+    int sampleRate; ///< Sample rate in Hz
+    int blockFrames; ///< Block length of blockCoefficient, 0 if it has to be recalculated
+    float blockCoefficient; ///< Part of the distance to the target covered in blockFrames samples
+};
@@ -0,0 +1,88 @@
+#include "patch.h"
+#include "moogLadderFilter.h"
+
+Patch::Patch() :
+    alpha(0.5),
+    beta(0.5),
+    gamma(0.5),
+    cutOff(10000.0),
+    resonance(1.0),
+    attack(0.01),
+    decay(0.5),
+    sustain(0.1),
+    release(1.0),
+    filterAttack(0.01),
+    filterDecay(0.5),
+    filterSustain(0.1),
+    filterRelease(1.0),
+    filterType(MoogLadderFilter::LPF4),
+    version(1) {
+}
+
+void Patch::setOscillatorMix(float alpha, float beta, float gamma) {
+    if(alpha == this->alpha && beta == this->beta && gamma == this->gamma)
+        return;
+    this->alpha = alpha;
+    this->beta = beta;
+    this->gamma = gamma;
+    version++;
+}
+
+void Patch::setCutOff(float cutOff) {
+    if(cutOff == this->cutOff)
+        return;
+    this->cutOff = cutOff;
+    version++;
+}
+
+void Patch::setResonance(float resonance) {
+    if(resonance == this->resonance)
+        return;
+    this->resonance = resonance;
+    version++;
+}
+
+void Patch::setAttack(double attack) {
+    this->attack = attack;
+    version++;
+}
+
+void Patch::setDecay(double decay) {
+    this->decay = decay;
+    version++;
+}
+
+void Patch::setSustain(double sustain) {
+    this->sustain = sustain;
+    version++;
+}
+
+void Patch::setRelease(double release) {
+    this->release = release;
+    version++;
+}
+
+void Patch::setFilterAttack(double attack) {
+    filterAttack = attack;
+    version++;
+}
+
+void Patch::setFilterDecay(double decay) {
+    filterDecay = decay;
+    version++;
+}
+
+void Patch::setFilterSustain(double sustain) {
+    filterSustain = sustain;
+    version++;
+}
+
+void Patch::setFilterRelease(double release) {
+    filterRelease = release;
+    version++;
+}
+
+void Patch::setFilterType(unsigned int type) {
+    filterType = type;
+    version++;
+}
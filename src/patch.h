@@ -0,0 +1,98 @@
+/**
+ * \class Patch
+ *
+ *
+ * \brief Sound parameters shared by all keys of a Midi2KeyHandler.
+ *
+ * Controllers write the patch once instead of calling setters on every key.
+ * Every change increments the version. A key that was given the patch with
+ * Key::setPatch() compares the version at the start of a render chunk and only
+ * copies the values if it changed (Key::applyPatch()). The filter coefficients
+ * are derived from the cut-off per control interval while rendering anyway, so
+ * a cut-off change costs no MoogLadderFilter::update() at all.
+ *
+ * The patch is written between render chunks on the audio thread and read by
+ * the render workers, the start of WorkerPool::run() orders both.
+ *
+ * \author $Author: Corvin Jaedicke & Alberto Monciero $
+ *
+ * \version $Revision: 1.5 $
+ *
+ * \date $Date: 2017/29/04 21:14:27 $
+ *
+ * Contact: c.jaedicke@math.tu-berlin.de
+ *
+ */
+
+#pragma once
+
+class Patch
+{
+public:
+    /// Patch with the defaults of a new Key
+    Patch();
+
+    /**
+     * \brief Set the vector mix of the four waves.
+     * \param alpha Mix of square- and custom-wave
+     * \param beta Mix of saw- and triangle-wave
+     * \param gamma Mix of the two mixes
+     */
+    void setOscillatorMix(float alpha, float beta, float gamma);
+    /// Set the cut-off frequency in Hz.
+    void setCutOff(float cutOff);
+    /// Set the filter resonance (1..4).
+    void setResonance(float resonance);
+    /// Set the attack of the volume envelope in seconds.
+    void setAttack(double attack);
+    /// Set the decay of the volume envelope in seconds.
+    void setDecay(double decay);
+    /// Set the sustain level of the volume envelope.
+    void setSustain(double sustain);
+    /// Set the release of the volume envelope in seconds.
+    void setRelease(double release);
+    /// Set the attack of the filter envelope in seconds.
+    void setFilterAttack(double attack);
+    /// Set the decay of the filter envelope in seconds.
+    void setFilterDecay(double decay);
+    /// Set the sustain level of the filter envelope.
+    void setFilterSustain(double sustain);
+    /// Set the release of the filter envelope in seconds.
+    void setFilterRelease(double release);
+    /// Set the filter type (MoogLadderFilter::LPF4, HPF2, ...).
+    void setFilterType(unsigned int type);
+
+    float getAlpha() const {return alpha;}
+    float getBeta() const {return beta;}
+    float getGamma() const {return gamma;}
+    float getCutOff() const {return cutOff;}
+    float getResonance() const {return resonance;}
+    double getAttack() const {return attack;}
+    double getDecay() const {return decay;}
+    double getSustain() const {return sustain;}
+    double getRelease() const {return release;}
+    double getFilterAttack() const {return filterAttack;}
+    double getFilterDecay() const {return filterDecay;}
+    double getFilterSustain() const {return filterSustain;}
+    double getFilterRelease() const {return filterRelease;}
+    unsigned int getFilterType() const {return filterType;}
+    /// Incremented by every change, keys compare it with the version they copied last.
+    unsigned int getVersion() const {return version;}
+
+private:
+    float alpha; ///< Mix of square- and custom-wave
+    float beta; ///< Mix of saw- and triangle-wave
+    float gamma; ///< Mix of the two wave mixes
+    float cutOff; ///< Cut-off frequency in Hz
+    float resonance; ///< Filter resonance K
+    double attack; ///< Attack of the volume envelope
+    double decay; ///< Decay of the volume envelope
+    double sustain; ///< Sustain level of the volume envelope
+    double release; ///< Release of the volume envelope
+    double filterAttack; ///< Attack of the filter envelope
+    double filterDecay; ///< Decay of the filter envelope
+    double filterSustain; ///< Sustain level of the filter envelope
+    double filterRelease; ///< Release of the filter envelope
+    unsigned int filterType; ///< Oberheim variation of the ladder filter
+    unsigned int version; ///< Number of changes, starts at 1
+};
@@ -0,0 +1,136 @@
+#include "realtimeCheck.h"
+
+#ifdef VECTORSYNTH_RT_CHECK
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// the allocator of glibc under its internal names, called by the replacements below
+extern "C" {
+void * __libc_malloc(size_t size);
+void * __libc_calloc(size_t n, size_t size);
+void * __libc_realloc(void * p, size_t size);
+void * __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void * p);
+}
+
+namespace {
+
+thread_local int depth = 0; ///< Nesting of realtime scopes on this thread
+thread_local bool reporting = false; ///< Set while a violation is reported, the report may allocate itself
+std::atomic<int> violations(0); ///< Violations of all threads
+bool abortOnViolation = false; ///< VECTORSYNTH_RT_ABORT=1
+
+typedef int (*MutexLock)(pthread_mutex_t *);
+MutexLock realMutexLock = NULL; ///< pthread_mutex_lock of libc
+
+/// Writes to stderr without stdio, which may lock or allocate.
+void writeError(const char * text) {
+    ssize_t written = write(STDERR_FILENO, text, strlen(text));
+    (void) written;
+}
+
+/// Counts and reports a forbidden call if the current thread is in a realtime scope.
+void check(const char * function) {
+    if(depth == 0 || reporting)
+        return;
+    reporting = true;
+    violations++;
+    writeError("RealtimeCheck: ");
+    writeError(function);
+    writeError(" called in a realtime section\n");
+    void * frames[32];
+    int n = backtrace(frames, 32);
+    // first frame is check() itself
+    backtrace_symbols_fd(frames + 1, n - 1, STDERR_FILENO);
+    if(abortOnViolation)
+        abort();
+    reporting = false;
+}
+
+/// Resolves pthread_mutex_lock of libc, dlsym does not use the public mutex functions.
+MutexLock mutexLock() {
+    if(realMutexLock == NULL)
+        realMutexLock = (MutexLock) dlsym(RTLD_NEXT, "pthread_mutex_lock");
+    return realMutexLock;
+}
+
+bool prepared = (RealtimeCheck::prepare(), true);
+
+}
+
+void RealtimeCheck::enter() {
+    depth++;
+}
+
+void RealtimeCheck::leave() {
+    depth--;
+}
+
+int RealtimeCheck::getViolations() {
+    return violations;
+}
+
+void RealtimeCheck::prepare() {
+    // the first backtrace() loads libgcc, which allocates
+    void * frames[2];
+    backtrace(frames, 2);
+    mutexLock();
+    const char * value = getenv("VECTORSYNTH_RT_ABORT");
+    abortOnViolation = value != NULL && strcmp(value, "1") == 0;
+    (void) prepared;
+}
+
+extern "C" {
+
+void * malloc(size_t size) __THROW {
+    check("malloc");
+    return __libc_malloc(size);
+}
+
+void * calloc(size_t n, size_t size) __THROW {
+    check("calloc");
+    return __libc_calloc(n, size);
+}
+
+void * realloc(void * p, size_t size) __THROW {
+    check("realloc");
+    return __libc_realloc(p, size);
+}
+
+void free(void * p) __THROW {
+    if(p != NULL)
+        check("free");
+    __libc_free(p);
+}
+
+void * memalign(size_t alignment, size_t size) __THROW {
+    check("memalign");
+    return __libc_memalign(alignment, size);
+}
+
+void * aligned_alloc(size_t alignment, size_t size) __THROW {
+    check("aligned_alloc");
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void ** p, size_t alignment, size_t size) __THROW {
+    check("posix_memalign");
+    *p = __libc_memalign(alignment, size);
+    return *p != NULL ? 0 : ENOMEM;
+}
+
+int pthread_mutex_lock(pthread_mutex_t * mutex) __THROWNL {
+    check("pthread_mutex_lock");
+    return mutexLock()(mutex);
+}
+
+}
+
+#endif
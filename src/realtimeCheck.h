@@ -0,0 +1,71 @@
+/**
+ * \class RealtimeCheck
+ *
+ *
+ * \brief Debug trap for allocations and locks on the audio threads.
+ *
+ * Everything reachable from VectorSynth::audioCallback() follows one contract:
+ * no allocation, no locks and no syscalls. The only exception is the semaphore
+ * hand-off of WorkerPool::run(). The contract covers the JACK thread and the
+ * render workers. Buffers are sized at construction, MIDI arrives through
+ * lock-free queues and nothing prints. Thread set-up, like pinning the JACK
+ * thread (WorkerPool::pinCaller()), happens once outside of the callback.
+ *
+ * Code on these threads runs inside a RealtimeCheck::Scope. Built with
+ * VECTORSYNTH_RT_CHECK defined (RT_CHECK=1 sh build.sh), this file interposes
+ * malloc, calloc, realloc, free, the aligned allocators and pthread_mutex_lock.
+ * Only these are enforced, other syscalls are not trapped and stay a rule for review.
+ * A call inside a scope is counted and reported with a backtrace of the call
+ * site on stderr, so a regression is found before it turns into an xrun.
+ * With the environment variable VECTORSYNTH_RT_ABORT=1 the first violation
+ * aborts, for a core dump or a debugger.
+ * Without VECTORSYNTH_RT_CHECK every function of this class is an empty inline function.
+ *
+ * \author $Author: Corvin Jaedicke & Alberto Monciero $
+ *
+ * \version $Revision: 1.5 $
+ *
+ * \date $Date: 2017/29/04 21:14:27 $
+ *
+ * Contact: c.jaedicke@math.tu-berlin.de
+ *
+ */
+
+#pragma once
+
+class RealtimeCheck
+{
+public:
+    /// Marks the current thread as realtime until the end of the enclosing block, may be nested.
+    class Scope
+    {
+    public:
+        Scope(){enter();}
+        ~Scope(){leave();}
+    private:
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+    };
+
+#ifdef VECTORSYNTH_RT_CHECK
+    static const bool enabled = true; ///< true if the trap is compiled in
+    /// The current thread enters a realtime section.
+    static void enter();
+    /// The current thread leaves a realtime section.
+    static void leave();
+    /// Number of violations since start-up, all threads.
+    static int getViolations();
+    /**
+     * \brief Loads everything the report needs, so the first violation does not allocate itself.
+     *
+     * Called on start-up, call it again from threads that load libraries late.
+     */
+    static void prepare();
+#else
+    static const bool enabled = false; ///< true if the trap is compiled in
+    static void enter(){}
+    static void leave(){}
+    static int getViolations(){return 0;}
+    static void prepare(){}
+#endif
+};
@@ -0,0 +1,40 @@
+#include "saturation.h"
+
+constexpr float Saturation::tableRange;
+
+float Saturation::table[Saturation::tableSize+1];
+bool Saturation::tableFilled = Saturation::fillTable();
+
+bool Saturation::fillTable() {
+    for(int k = 0; k <= tableSize; k++) {
+        table[k] = std::tanh(-tableRange + 2.0 * tableRange * k / tableSize);
+    }
+    return true;
+}
+
+double Saturation::maxError(Mode mode) {
+    double error = 0.0;
+    // denser than the table, so the error between two table points is found
+    for(int k = -200000; k <= 200000; k++) {
+        float x = k * 5e-5f;
+        double e = fabs((double) process(mode, x) - std::tanh((double) x));
+        if(e > error)
+            error = e;
+    }
+    return error;
+}
+
+const char * Saturation::name(Mode mode) {
+    switch (mode)
+    {
+    case SATURATION_LIBM:
+        return "libm";
+    case SATURATION_TABLE:
+        return "table";
+    case SATURATION_PADE:
+        return "pade";
+    case SATURATION_BYPASS:
+    default:
+        return "bypass";
+    }
+}
@@ -0,0 +1,144 @@
+/**
+ * \class Saturation
+ *
+ *
+ * \brief tanh saturation of the ladder filter in selectable quality.
+ *
+ * The saturation compensation of MoogLadderFilter runs once per voice and sample,
+ * with libm tanh it is one of the most expensive calls of the render loop.
+ * Every filter chooses one of these implementations (see MoogLadderFilter::setSaturation()):
+ * - SATURATION_LIBM: std::tanh, the reference
+ * - SATURATION_TABLE: linear interpolation in a table over +-tableRange, max error below 2e-5
+ * - SATURATION_PADE: rational approximation, max error about 1e-4 (default)
+ * - SATURATION_BYPASS: no saturation at all, the ladder stays linear
+ *
+ * The modes are ordered by accuracy. maxError() measures the error of a mode
+ * against the reference, the benchmark prints it next to the speed.
+ *
+ * \author $Author: Corvin Jaedicke & Alberto Monciero $
+ *
+ * \version $Revision: 1.5 $
+ *
+ * \date $Date: 2017/29/04 19:14:45 $
+ *
+ * Contact: c.jaedicke@math.tu-berlin.de
+ *
+ */
+
+#pragma once
+
+#include <cmath>
+
+#include "simd.h"
+
+struct Saturation
+{
+    /// Implementations of tanh, the most accurate first
+    enum Mode {
+        SATURATION_LIBM = 0,
+        SATURATION_TABLE,
+        SATURATION_PADE,
+        SATURATION_BYPASS,
+        numModes
+    };
+
+    static const int tableSize = 1024; ///< Intervals of the tanh table
+    static constexpr float tableRange = 6.0; ///< The table covers -tableRange..tableRange, outside tanh is +-1
+
+    /**
+     * \brief tanh of one sample.
+     * \tparam mode Implementation
+     * \param x Input
+     * \return Saturated input
+     */
+    template <Mode mode>
+    static inline float process(float x) {
+        switch (mode)
+        {
+        case SATURATION_LIBM:
+            return std::tanh(x);
+        case SATURATION_TABLE:
+            return lookUp(x);
+        case SATURATION_PADE:
+            return pade(x);
+        case SATURATION_BYPASS:
+        default:
+            return x;
+        }
+    }
+    /// tanh of one sample with the implementation chosen at runtime.
+    static inline float process(Mode mode, float x) {
+        switch (mode)
+        {
+        case SATURATION_LIBM:
+            return process<SATURATION_LIBM>(x);
+        case SATURATION_TABLE:
+            return process<SATURATION_TABLE>(x);
+        case SATURATION_PADE:
+            return process<SATURATION_PADE>(x);
+        case SATURATION_BYPASS:
+        default:
+            return process<SATURATION_BYPASS>(x);
+        }
+    }
+    /**
+     * \brief tanh of four lanes.
+     * \tparam mode Implementation, libm and table work lane by lane
+     * \param x Input
+     * \return Saturated input
+     */
+    template <Mode mode>
+    static inline simd::float4 process4(simd::float4 x) {
+        switch (mode)
+        {
+        case SATURATION_LIBM:
+        case SATURATION_TABLE: {
+            float lanes[4];
+            simd::store(lanes, x);
+            for(int v = 0; v < 4; v++) {
+                lanes[v] = process<mode>(lanes[v]);
+            }
+            return simd::load(lanes);
+        }
+        case SATURATION_PADE:
+            return simd::tanh(x);
+        case SATURATION_BYPASS:
+        default:
+            return x;
+        }
+    }
+
+    /// Rational (Pade) approximation, same as simd::tanh() for one sample.
+    static inline float pade(float x) {
+        x = x < -4.97f ? -4.97f : (x > 4.97f ? 4.97f : x);
+        float x2 = x * x;
+        float num = ((x2 + 378.0f) * x2 + 17325.0f) * x2 + 135135.0f;
+        float den = ((28.0f * x2 + 3150.0f) * x2 + 62370.0f) * x2 + 135135.0f;
+        return x * num / den;
+    }
+    /// Linear interpolation in the tanh table.
+    static inline float lookUp(float x) {
+        float position = (x + tableRange) * (tableSize / (2.0f * tableRange));
+        if(position <= 0.0f)
+            return -1.0f;
+        if(position >= (float) tableSize)
+            return 1.0f;
+        int i = (int) position;
+        return table[i] + (table[i+1] - table[i]) * (position - i);
+    }
+
+    /**
+     * \brief Measures the error of an implementation.
+     * \param mode Implementation
+     * \return Largest absolute difference to std::tanh on a fine grid over -10..10
+     */
+    static double maxError(Mode mode);
+    /// Name of a mode for messages and benchmarks ("libm", "table", "pade", "bypass").
+    static const char * name(Mode mode);
+
+private:
+    static float table[tableSize+1]; ///< tanh over -tableRange..tableRange
+    /// Fills table, called once on start-up.
+    static bool fillTable();
+    static bool tableFilled; ///< Forces fillTable() during static initialization
+};
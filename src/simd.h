@@ -0,0 +1,130 @@
+/**
+ * \file simd.h
+ *
+ *
+ * \brief Minimal 4-lane float vector used by the voice-parallel DSP code.
+ *
+ * Maps to NEON on the RPi3 (ARMv7 and AArch64) and to SSE on x86 dev boxes.
+ * Without either, or with VECTORSYNTH_NO_SIMD defined, a plain struct is used,
+ * which gives the same results and is handy for debugging.
+ * Only the few operations needed by the filters are provided.
+ *
+ * \author $Author: Corvin Jaedicke & Alberto Monciero $
+ *
+ * \version $Revision: 1.5 $
+ *
+ * \date $Date: 2017/29/04 19:14:45 $
+ *
+ * Contact: c.jaedicke@math.tu-berlin.de
+ *
+ */
+
+#pragma once
+
+#if !defined(VECTORSYNTH_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define VECTORSYNTH_NEON
+#include <arm_neon.h>
+#elif !defined(VECTORSYNTH_NO_SIMD) && (defined(__SSE__) || defined(_M_X64))
+#define VECTORSYNTH_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace simd
+{
+
+#if defined(VECTORSYNTH_NEON)
+
+typedef float32x4_t float4;
+
+inline float4 load(const float * p) {return vld1q_f32(p);}
+inline void store(float * p, float4 a) {vst1q_f32(p, a);}
+inline float4 set1(float a) {return vdupq_n_f32(a);}
+inline float4 add(float4 a, float4 b) {return vaddq_f32(a, b);}
+inline float4 sub(float4 a, float4 b) {return vsubq_f32(a, b);}
+inline float4 mul(float4 a, float4 b) {return vmulq_f32(a, b);}
+inline float4 min(float4 a, float4 b) {return vminq_f32(a, b);}
+inline float4 max(float4 a, float4 b) {return vmaxq_f32(a, b);}
+inline float4 div(float4 a, float4 b) {
+#if defined(__aarch64__)
+    return vdivq_f32(a, b);
+#else
+    // ARMv7 NEON has no divide: reciprocal estimate refined by two Newton steps
+    float4 r = vrecpeq_f32(b);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    return vmulq_f32(a, r);
+#endif
+}
+/// Transposes four vectors, e.g. four samples of four voices into four voices of four samples.
+inline void transpose(float4 & a, float4 & b, float4 & c, float4 & d) {
+    float32x4x2_t ab = vtrnq_f32(a, b);
+    float32x4x2_t cd = vtrnq_f32(c, d);
+    a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+    b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+    c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+    d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+
+#elif defined(VECTORSYNTH_SSE)
+
+typedef __m128 float4;
+
+inline float4 load(const float * p) {return _mm_loadu_ps(p);}
+inline void store(float * p, float4 a) {_mm_storeu_ps(p, a);}
+inline float4 set1(float a) {return _mm_set1_ps(a);}
+inline float4 add(float4 a, float4 b) {return _mm_add_ps(a, b);}
+inline float4 sub(float4 a, float4 b) {return _mm_sub_ps(a, b);}
+inline float4 mul(float4 a, float4 b) {return _mm_mul_ps(a, b);}
+inline float4 min(float4 a, float4 b) {return _mm_min_ps(a, b);}
+inline float4 max(float4 a, float4 b) {return _mm_max_ps(a, b);}
+inline float4 div(float4 a, float4 b) {return _mm_div_ps(a, b);}
+/// Transposes four vectors, e.g. four samples of four voices into four voices of four samples.
+inline void transpose(float4 & a, float4 & b, float4 & c, float4 & d) {
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+}
+
+#else
+
+struct float4 {float v[4];};
+
+inline float4 load(const float * p) {float4 r = {{p[0], p[1], p[2], p[3]}}; return r;}
+inline void store(float * p, float4 a) {for(int i = 0; i < 4; i++) p[i] = a.v[i];}
+inline float4 set1(float a) {float4 r = {{a, a, a, a}}; return r;}
+inline float4 add(float4 a, float4 b) {for(int i = 0; i < 4; i++) a.v[i] += b.v[i]; return a;}
+inline float4 sub(float4 a, float4 b) {for(int i = 0; i < 4; i++) a.v[i] -= b.v[i]; return a;}
+inline float4 mul(float4 a, float4 b) {for(int i = 0; i < 4; i++) a.v[i] *= b.v[i]; return a;}
+inline float4 min(float4 a, float4 b) {for(int i = 0; i < 4; i++) a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return a;}
+inline float4 max(float4 a, float4 b) {for(int i = 0; i < 4; i++) a.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return a;}
+inline float4 div(float4 a, float4 b) {for(int i = 0; i < 4; i++) a.v[i] /= b.v[i]; return a;}
+/// Transposes four vectors, e.g. four samples of four voices into four voices of four samples.
+inline void transpose(float4 & a, float4 & b, float4 & c, float4 & d) {
+    float4 t[4] = {a, b, c, d};
+    for(int i = 0; i < 4; i++) {
+        a.v[i] = t[i].v[0];
+        b.v[i] = t[i].v[1];
+        c.v[i] = t[i].v[2];
+        d.v[i] = t[i].v[3];
+    }
+}
+
+#endif
+
+/// Multiply-add a * b + c.
+inline float4 madd(float4 a, float4 b, float4 c) {return add(mul(a, b), c);}
+
+/**
+ * \brief Rational (Pade) approximation of tanh for all four lanes.
+ * \param x Input
+ * \return tanh(x), absolute error below 1e-4
+ *
+ * The input is clamped to +-4.97 where the approximation reaches 1.
+ */
+inline float4 tanh(float4 x) {
+    x = min(max(x, set1(-4.97f)), set1(4.97f));
+    float4 x2 = mul(x, x);
+    float4 num = madd(madd(madd(x2, set1(1.0f), set1(378.0f)), x2, set1(17325.0f)), x2, set1(135135.0f));
+    float4 den = madd(madd(madd(x2, set1(28.0f), set1(3150.0f)), x2, set1(62370.0f)), x2, set1(135135.0f));
+    return div(mul(x, num), den);
+}
+
+}
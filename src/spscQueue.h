@@ -0,0 +1,78 @@
+/**
+ * \class SpscQueue
+ *
+ *
+ * \brief Lock-free single-producer/single-consumer ring buffer.
+ *
+ * A fixed-size FIFO for handing small messages from one thread to another.
+ * All memory is part of the object, so push() and pop() never allocate and
+ * never block. Exactly one thread may call push() and exactly one other
+ * thread may call pop(), e.g. the RtMidi callback thread and the JACK process thread.
+ *
+ * \author $Author: Corvin Jaedicke & Alberto Monciero $
+ *
+ * \version $Revision: 1.5 $
+ *
+ * \date $Date: 2017/29/04 21:14:27 $
+ *
+ * Contact: c.jaedicke@math.tu-berlin.de
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+
+template <typename T, unsigned int capacity>
+class SpscQueue
+{
+    static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0, "capacity has to be a power of two");
+
+public:
+    /// Empty queue
+    SpscQueue() :
+    head(0),
+    tail(0) {
+    };
+
+    /**
+     * \brief Append an element (producer thread only).
+     * \param item Element to copy into the queue
+     * \return false if the queue is full and the element was dropped
+     */
+    bool push(const T& item) {
+        const unsigned int t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == capacity) {
+            return false;
+        }
+        buffer[t & (capacity - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * \brief Take the oldest element (consumer thread only).
+     * \param item Receives the element
+     * \return false if the queue is empty
+     */
+    bool pop(T& item) {
+        const unsigned int h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = buffer[h & (capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// True if no element is waiting (only exact on the consumer side).
+    bool isEmpty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    T buffer[capacity]; ///< Preallocated storage
+    std::atomic<unsigned int> head; ///< Read position, written by consumer only
+    char padding[64]; ///< Keeps head and tail on different cache lines
+    std::atomic<unsigned int> tail; ///< Write position, written by producer only
+};
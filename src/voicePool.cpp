@@ -0,0 +1,109 @@
+#include "voicePool.h"
+
+VoicePool::VoicePool() {
+    for(int slot = 0; slot < capacity; slot++) {
+        clear(slot);
+    }
+}
+
+void VoicePool::load(int slot, Key & key) {
+    Group & group = groups[slot / 4];
+    int lane = slot % 4;
+    key.volumeEnvelope.getRenderState(group.volumeLevel[lane], group.volumeMultiplier[lane], group.volumeRemaining[lane]);
+    key.filterEnvelope.getRenderState(group.filterLevel[lane], group.filterMultiplier[lane], group.filterRemaining[lane]);
+    group.filterG[lane] = key._filterG;
+    group.saturation[lane] = key.moog.getSaturation();
+    group.oversampler[lane] = key.moog.getOversampler();
+    float * pState[4] = {group.filterState[0], group.filterState[1], group.filterState[2], group.filterState[3]};
+    float * pParameters[MoogLadderFilter::numLaneParameters];
+    for(int p = 0; p < MoogLadderFilter::numLaneParameters; p++) {
+        pParameters[p] = group.filterParameters[p];
+    }
+    key.moog.getLaneState(pState, pParameters, lane);
+}
+
+void VoicePool::loadParameters(int slot, const Key & key) {
+    Group & group = groups[slot / 4];
+    int lane = slot % 4;
+    // the ladder hands out state and parameters together, the state of the lane is kept
+    float state[4][4];
+    float * pState[4] = {state[0], state[1], state[2], state[3]};
+    float * pParameters[MoogLadderFilter::numLaneParameters];
+    for(int p = 0; p < MoogLadderFilter::numLaneParameters; p++) {
+        pParameters[p] = group.filterParameters[p];
+    }
+    key.moog.getLaneState(pState, pParameters, lane);
+    group.saturation[lane] = key.moog.getSaturation();
+}
+
+void VoicePool::store(int slot, Key & key) {
+    Group & group = groups[slot / 4];
+    int lane = slot % 4;
+    key.volumeEnvelope.setRenderState(group.volumeLevel[lane], group.volumeMultiplier[lane], group.volumeRemaining[lane]);
+    key.filterEnvelope.setRenderState(group.filterLevel[lane], group.filterMultiplier[lane], group.filterRemaining[lane]);
+    const float * const pState[4] = {group.filterState[0], group.filterState[1], group.filterState[2], group.filterState[3]};
+    key.moog.setLaneState(pState, lane);
+    if(group.filterG[lane] != key.moog.getG()) {
+        key.moog.setG(group.filterG[lane]);
+    }
+}
+
+void VoicePool::clear(int slot, float g) {
+    Group & group = groups[slot / 4];
+    int lane = slot % 4;
+    silence(slot);
+    for(int s = 0; s < 4; s++) {
+        group.filterState[s][lane] = 0.0;
+    }
+    for(int p = 0; p < MoogLadderFilter::numLaneParameters; p++) {
+        group.filterParameters[p][lane] = 0.0;
+    }
+    group.filterG[lane] = g;
+    // filler lanes never make the other lanes of their group more expensive
+    group.saturation[lane] = Saturation::SATURATION_BYPASS;
+    group.oversampler[lane] = NULL;
+}
+
+void VoicePool::silence(int slot) {
+    Group & group = groups[slot / 4];
+    int lane = slot % 4;
+    group.volumeLevel[lane] = 0.0;
+    group.volumeMultiplier[lane] = 1.0;
+    group.volumeRemaining[lane] = Envelope::noStageChange;
+    group.filterLevel[lane] = 0.0;
+    group.filterMultiplier[lane] = 1.0;
+    group.filterRemaining[lane] = Envelope::noStageChange;
+}
+
+void VoicePool::renderEnvelopes4(int first, Key * keys[4], float * pVolume[4], float * pFilter[4], int nFrames) {
+    Group & group = groups[first / 4];
+    Envelope * volume[4];
+    Envelope * filter[4];
+    for(int v = 0; v < 4; v++) {
+        volume[v] = keys[v] ? &(keys[v]->volumeEnvelope) : NULL;
+        filter[v] = keys[v] ? &(keys[v]->filterEnvelope) : NULL;
+    }
+    Envelope::renderBlock4(volume, group.volumeLevel, group.volumeMultiplier, group.volumeRemaining, pVolume, nFrames);
+    Envelope::renderBlock4(filter, group.filterLevel, group.filterMultiplier, group.filterRemaining, pFilter, nFrames);
+}
+
+void VoicePool::renderFilters4(int first, float * pVoices[4], const float * pG[4], int nFrames) {
+    Group & group = groups[first / 4];
+    float * pState[4] = {group.filterState[0], group.filterState[1], group.filterState[2], group.filterState[3]};
+    const float * pParameters[MoogLadderFilter::numLaneParameters];
+    for(int p = 0; p < MoogLadderFilter::numLaneParameters; p++) {
+        pParameters[p] = group.filterParameters[p];
+    }
+    Saturation::Mode mode = group.saturation[0];
+    for(int v = 1; v < 4; v++) {
+        if(group.saturation[v] < mode) {
+            mode = group.saturation[v];
+        }
+    }
+    MoogLadderFilter::renderBlock4(pState, pParameters, pVoices, pG, nFrames, mode, group.oversampler);
+    if(nFrames > 0) {
+        for(int v = 0; v < 4; v++) {
+            group.filterG[v] = pG[v][nFrames-1];
+        }
+    }
+}
@@ -0,0 +1,113 @@
+/**
+ * \class VoicePool
+ *
+ *
+ * \brief Render state of all sounding keys in structure-of-arrays form.
+ *
+ * The slots are indexed like the active-key list. Four neighbouring slots form a
+ * group, the four SIMD lanes of Envelope::renderBlock4() and MoogLadderFilter::renderBlock4().
+ * Inside a group every field (envelope level, multiplier, filter state, ...) is stored
+ * as four contiguous values, so the lanes are loaded straight from memory. Every group
+ * starts on its own cache line and the workers always render whole groups, so two
+ * cores never write to the same line.
+ *
+ * While a key keeps its slot the pool owns its running state: load() copies it in
+ * once, then it stays in the pool from chunk to chunk. store() gives it back before
+ * the Key object is changed from outside (note-on/off, stealing, set-up) or before
+ * the key moves to another slot. Stage changes still run on the Envelope objects of
+ * the keys, their stage lengths and sustain level never live in the pool.
+ *
+ * \author $Author: Corvin Jaedicke & Alberto Monciero $
+ *
+ * \version $Revision: 1.5 $
+ *
+ * \date $Date: 2017/29/04 21:14:27 $
+ *
+ * Contact: c.jaedicke@math.tu-berlin.de
+ *
+ */
+
+#pragma once
+
+#include "key.h"
+
+class VoicePool
+{
+public:
+    static const int capacity = 32; ///< Number of slots, a multiple of four
+    static const int cacheLineSize = WaveTables::cacheLineSize; ///< Alignment of every group in bytes
+
+    /// Empty pool, all slots silent
+    VoicePool();
+
+    /**
+     * \brief Copies the render state of a key into a slot.
+     * \param slot Slot of the key
+     * \param key Key to copy from, the slot keeps a pointer to its Oversampler
+     */
+    void load(int slot, Key & key);
+    /**
+     * \brief Copies only the filter parameters of a key into its slot.
+     * \param slot Slot of the key
+     * \param key Key to copy from, after a patch change of resonance or filter type
+     */
+    void loadParameters(int slot, const Key & key);
+    /**
+     * \brief Gives the render state of a slot back to its key.
+     * \param slot Slot of the key
+     * \param key Key to copy to
+     */
+    void store(int slot, Key & key);
+    /**
+     * \brief Makes a slot a silent filler lane.
+     * \param slot Slot without key
+     * \param g Filter coefficient the lane keeps
+     *
+     * Envelopes stay at zero, the filter has no state and no output.
+     */
+    void clear(int slot, float g = 0.0);
+    /// Stops the envelopes of a slot whose key has finished, its filter state is kept.
+    void silence(int slot);
+
+    /**
+     * \brief Renders both envelopes of the four keys in slots first to first+3.
+     * \param first First slot, a multiple of four
+     * \param keys Keys of the four slots, NULL for filler lanes
+     * \param pVolume Volume envelope of every lane, overwritten
+     * \param pFilter Filter envelope of every lane, overwritten
+     * \param nFrames Number of samples, <= Key::maxBlockSize
+     */
+    void renderEnvelopes4(int first, Key * keys[4], float * pVolume[4], float * pFilter[4], int nFrames);
+    /**
+     * \brief Runs the ladder filters of the four keys in slots first to first+3.
+     * \param first First slot, a multiple of four
+     * \param pVoices Unfiltered voice of every lane, filtered in place
+     * \param pG Filter coefficient of every lane for every sample
+     * \param nFrames Number of samples
+     *
+     * The most accurate saturation mode of the four slots is used for all of them.
+     * Oversampled keys are up- and down-sampled through the Oversampler of their filter.
+     */
+    void renderFilters4(int first, float * pVoices[4], const float * pG[4], int nFrames);
+    /// Filter coefficient of the last rendered sample of a slot.
+    float getG(int slot) const {return groups[slot / 4].filterG[slot % 4];}
+    /// Level of the volume envelope of a slot, the key's own level is out of date while it is loaded.
+    float getVolumeLevel(int slot) const {return groups[slot / 4].volumeLevel[slot % 4];}
+
+private:
+    /// Four slots, one per SIMD lane
+    struct alignas(cacheLineSize) Group {
+        float volumeLevel[4]; ///< Volume envelope level
+        float volumeMultiplier[4]; ///< Volume envelope multiplier
+        int volumeRemaining[4]; ///< Samples until the next stage of the volume envelope
+        float filterLevel[4]; ///< Filter envelope level
+        float filterMultiplier[4]; ///< Filter envelope multiplier
+        int filterRemaining[4]; ///< Samples until the next stage of the filter envelope
+        float filterState[4][4]; ///< z-1 memory of the four ladder stages
+        float filterParameters[MoogLadderFilter::numLaneParameters][4]; ///< K, A, B, C, D, E of the ladder
+        float filterG[4]; ///< Last filter coefficient
+        Saturation::Mode saturation[4]; ///< Saturation of the filter, filler lanes are SATURATION_BYPASS
+        Oversampler * oversampler[4]; ///< Oversampler of the filter, NULL for filler lanes
+    };
+    Group groups[capacity / 4]; ///< All slots, group after group
+};
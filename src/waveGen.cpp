@@ -1,144 +1,134 @@
 #include "waveGen.h"
 
+constexpr float WaveGen::TWO_PI;
+constexpr double WaveGen::phaseRange;
+constexpr float WaveGen::radiansPerPhase;
+
 WaveGen::WaveGen(float f, float a, float p,  int fS, TYPE type)
 {
-    setFrequency(f);
-    amp          = a;
-    phi          = p;
     fs           = fS;
+    amp          = a;
     _type        = type;
-    phiIncrement = TWO_PI * freq * (1.0 / (float) fs);
+    // selects the mip table of _type
+    setFrequency(f);
+    setPhase(p);
 }
 
 float WaveGen::getNextSample() {
     float thisVal = 0.0;
     if(!isFreqZero) {
         aliasedWaveGen(_type, &thisVal);
-        // rotate to next step
-        phi += phiIncrement;
-        // wrap to 2 pi
-        if(phi >= TWO_PI)
-        {
-            phi -= TWO_PI;
-        }
-        
+        // rotate to next step, wraps to 2 pi by itself
+        rotatePhase();
     }
     return thisVal;
 }
 
 float WaveGen::getNextAntiAliasedSample() {
-
     float thisVal = 0.0;
-    if(!isFreqZero) {
-        float t = phi / TWO_PI;
-
-        switch (_type)
-        {
-            case SINUS:
-                aliasedWaveGen(SINUS, &thisVal);
-                break;
-            case CUSTOM_WAVE:
-                aliasedWaveGen(CUSTOM_WAVE, &thisVal);
-                break;
-            case SAWTOOTH:
-                aliasedWaveGen(SAWTOOTH , &thisVal);
-                thisVal -= polyBlep(t);
-                break;
-            case SQUARE:
-                aliasedWaveGen(SQUARE, &thisVal);
-                thisVal += polyBlep(t);
-                thisVal -= polyBlep(fmod(t + 0.5, 1.0));
-                break;
-            case TRIANGLE:
-                aliasedWaveGen(TRIANGLE, &thisVal);
-                break;
-        }
-        // rotate to next step
-        phi += phiIncrement;
-        // wrap to 2 pi
-        while(phi >= TWO_PI)
-        {
-            phi -= TWO_PI;
-        }
-    }
+    getNextAntiAliasedSample(&thisVal);
     return thisVal;
 }
 
 void WaveGen::getNextAntiAliasedSample(float * pSample) {
-    if(!isFreqZero) {
-        float t = phi / TWO_PI;
-
-        switch (_type)
-        {
-            case SINUS:
-                aliasedWaveGen(SINUS, pSample);
-                break;
-            case CUSTOM_WAVE:
-                aliasedWaveGen(CUSTOM_WAVE, pSample);
-                break;
-            case SAWTOOTH:
-                aliasedWaveGen(SAWTOOTH ,pSample);
-                *pSample -= polyBlep(t);
-                break;
-            case SQUARE:
-                aliasedWaveGen(SQUARE, pSample);
-                *pSample += polyBlep(t);
-                *pSample -= polyBlep(fmod(t + 0.5, 1.0));
-                break;
-            case TRIANGLE:
-                aliasedWaveGen(TRIANGLE, pSample);
-                break;
-        }
-        // rotate to next step
-        phi += phiIncrement;
-        // wrap to 2 pi
-        while(phi >= TWO_PI)
-        {
-            phi -= TWO_PI;
-        }
+    switch (_type)
+    {
+    case SINUS:
+        getNextAntiAliasedSample<SINUS>(pSample);
+        break;
+    case SQUARE:
+        getNextAntiAliasedSample<SQUARE>(pSample);
+        break;
+    case TRIANGLE:
+        getNextAntiAliasedSample<TRIANGLE>(pSample);
+        break;
+    case SAWTOOTH:
+        getNextAntiAliasedSample<SAWTOOTH>(pSample);
+        break;
+    case CUSTOM_WAVE:
+        getNextAntiAliasedSample<CUSTOM_WAVE>(pSample);
+        break;
     }
 }
 
-float WaveGen::polyBlep(float t)
-{
-    float dt = phiIncrement / TWO_PI;
-    // 0 <= t < 1
-    // begining of a period
-    if (t < dt) {
-        t /= dt;
-        return t+t - t*t - 1.0;
+void WaveGen::renderBlock(float * pBuffer, int nFrames) {
+    switch (_type)
+    {
+    case SINUS:
+        renderBlock<SINUS>(pBuffer, nFrames);
+        break;
+    case SQUARE:
+        renderBlock<SQUARE>(pBuffer, nFrames);
+        break;
+    case TRIANGLE:
+        renderBlock<TRIANGLE>(pBuffer, nFrames);
+        break;
+    case SAWTOOTH:
+        renderBlock<SAWTOOTH>(pBuffer, nFrames);
+        break;
+    case CUSTOM_WAVE:
+        renderBlock<CUSTOM_WAVE>(pBuffer, nFrames);
+        break;
     }
-    // -1 < t < 0
-    // ending of a period
-    else if (t > 1.0 - dt) {
-        t = (t - 1.0) / dt;
-        return t*t + t+t + 1.0;
+}
+
+void WaveGen::renderMix(float * pBuffer, const float * pMix, const float * pGain, int nFrames) {
+    if(isFreqZero) {
+        for(int i = 0; i < nFrames; i++) {
+            pBuffer[i] = 0.0;
+        }
+        return;
+    }
+    const float * square = WaveTables::mipTable(WaveTables::MIP_SQUARE, mipLevel);
+    const float * triangle = WaveTables::mipTable(WaveTables::MIP_TRIANGLE, mipLevel);
+    const float * sawtooth = WaveTables::mipTable(WaveTables::MIP_SAWTOOTH, mipLevel);
+    const float * custom = WaveTables::mipTable(WaveTables::MIP_CUSTOM, mipLevel);
+    float squareGain = pMix[WaveTables::MIP_SQUARE] * amp;
+    float triangleGain = pMix[WaveTables::MIP_TRIANGLE] * amp;
+    float sawtoothGain = pMix[WaveTables::MIP_SAWTOOTH] * amp;
+    float customGain = pMix[WaveTables::MIP_CUSTOM] * amp;
+    for(int i = 0; i < nFrames; i++) {
+        uint32_t k = phase >> mipShift;
+        float fraction = (float) (phase - (k << mipShift)) * mipFractionScale;
+        // all waves share index and weight, so mix the two neighbours first and interpolate once
+        float y1 = squareGain * square[k] + triangleGain * triangle[k]
+                 + sawtoothGain * sawtooth[k] + customGain * custom[k];
+        float y2 = squareGain * square[k+1] + triangleGain * triangle[k+1]
+                 + sawtoothGain * sawtooth[k+1] + customGain * custom[k+1];
+        pBuffer[i] = (y1 + (y2 - y1) * fraction) * pGain[i];
+        rotatePhase();
     }
-    // returns 0 most of the time
-    else return 0.0;
+}
+
+float WaveGen::getNextMixSample(const float * pMix) {
+    float gain = 1.0;
+    float sample = 0.0;
+    renderMix(&sample, pMix, &gain, 1);
+    return sample;
 }
 
 void WaveGen::aliasedWaveGenLUT(TYPE type, float * pSample) {
     switch (type)
     {
     case SINUS:
-        *pSample += lookUpSine(&phi) * amp;
+        *pSample += lookUpSine(phase) * amp;
         break; 
     case SQUARE:
-        if (phi <= M_PI)
+        // first half of the period, the sign bit of the phase is clear
+        if (phase < 0x80000000u)
             *pSample += 1;
         else
             *pSample -= 1;
         *pSample *= amp;
         break;
     case TRIANGLE:
-        *pSample += lookUpTriangle(&phi) * amp;
+        *pSample += lookUpTriangle(phase) * amp;
         break;
     case SAWTOOTH:
-        *pSample += lookUpSawtooth(&phi) * amp;
+        *pSample += lookUpSawtooth(phase) * amp;
         break;
     case CUSTOM_WAVE:
-        *pSample += lookUpCustomWave(&phi) * amp;
+        *pSample += lookUpCustomWave(phase) * amp;
         break;
     }
 }
@@ -147,60 +137,83 @@ void WaveGen::aliasedWaveGen(TYPE type, float * pSample) {
     switch (type)
     {
     case SINUS:
-        *pSample += (sin(phi) * amp);
-        break;  
+        *pSample += aliasedKernel<SINUS>() * amp;
+        break;
     case SQUARE:
-        if (phi <= M_PI)
-            *pSample += 1;
-        else
-            *pSample -= 1;
-        *pSample *= amp;
+        *pSample += aliasedKernel<SQUARE>() * amp;
         break;
     case TRIANGLE:
-        *pSample += 2.0 * (fabs(-1.0 + (2.0 * phi / TWO_PI)) - 0.5);
-        *pSample *= amp;
+        *pSample += aliasedKernel<TRIANGLE>() * amp;
         break;
     case SAWTOOTH:
-        *pSample += (2.0 * phi / TWO_PI) - 1.0;
-        *pSample *= amp;
+        *pSample += aliasedKernel<SAWTOOTH>() * amp;
         break;
     case CUSTOM_WAVE:
-        *pSample += lookUpCustomWave(&phi) * amp;
+        *pSample += aliasedKernel<CUSTOM_WAVE>() * amp;
         break;
     }
-    
 }
 
-float WaveGen::lookUpCustomWave(float * pPhi) {
-    int i = floor(*pPhi * factorLUT);
-    float y1 = customWave[i];
-    float y2 = customWave[i+1];
-    return y1 + (y2 - y1) * (*pPhi * factorLUT - i);
+float WaveGen::lookUpCustomWave(uint32_t p) {
+    uint32_t i = p >> shiftLUT;
+    float y1 = WaveTables::customWave[i];
+    float y2 = WaveTables::customWave[i+1];
+    return y1 + (y2 - y1) * (p - (i << shiftLUT)) * (1.0f / (1 << shiftLUT));
 }
 
-float WaveGen::lookUpSawtooth(float * pPhi) {
-    int i = floor(*pPhi * factorLUT);
-    float y1 = saw[i];
-    float y2 = saw[i+1];
-    return y1 + (y2 - y1) * (*pPhi * factorLUT - i);
+float WaveGen::lookUpSawtooth(uint32_t p) {
+    uint32_t i = p >> shiftLUT;
+    float y1 = WaveTables::saw[i];
+    float y2 = WaveTables::saw[i+1];
+    return y1 + (y2 - y1) * (p - (i << shiftLUT)) * (1.0f / (1 << shiftLUT));
 }
 
-float WaveGen::lookUpTriangle(float * pPhi) {
-    int i = floor(*pPhi * factorLUT);
-    float y1 = tri[i];
-    float y2 = tri[i+1];
-    return y1 + (y2 - y1) * (*pPhi * factorLUT - i);
+float WaveGen::lookUpTriangle(uint32_t p) {
+    uint32_t i = p >> shiftLUT;
+    float y1 = WaveTables::tri[i];
+    float y2 = WaveTables::tri[i+1];
+    return y1 + (y2 - y1) * (p - (i << shiftLUT)) * (1.0f / (1 << shiftLUT));
 }
 
-float WaveGen::lookUpSine(float * pPhi) {
-    int i = floor(*pPhi * factorLUT);
-    float y1 = sine[i];
-    float y2 = sine[i+1];
-    return y1 + (y2 - y1) * (*pPhi * factorLUT - i);
+float WaveGen::lookUpSine(uint32_t p) {
+    uint32_t i = p >> shiftLUT;
+    float y1 = WaveTables::sine[i];
+    float y2 = WaveTables::sine[i+1];
+    return y1 + (y2 - y1) * (p - (i << shiftLUT)) * (1.0f / (1 << shiftLUT));
 }
 
 void WaveGen::updatePhi() {
-    phiIncrement = TWO_PI * (freq / (float) fs);
+    // through a signed 64-bit value, so negative frequencies become a backwards rotation
+    phaseIncrement = (uint32_t) llround(fmod((double) freq / fs, 1.0) * phaseRange);
+    selectMipTable();
+}
+
+void WaveGen::selectMipTable() {
+    WaveTables::MipWave wave;
+    switch (_type)
+    {
+        case TRIANGLE:
+            wave = WaveTables::MIP_TRIANGLE;
+            break;
+        case SAWTOOTH:
+            wave = WaveTables::MIP_SAWTOOTH;
+            break;
+        case CUSTOM_WAVE:
+            wave = WaveTables::MIP_CUSTOM;
+            break;
+        case SQUARE:
+        default:
+            wave = WaveTables::MIP_SQUARE;
+            break;
+    }
+    mipLevel = WaveTables::mipLevel(fabs((int32_t) phaseIncrement / phaseRange));
+    mipTable = WaveTables::mipTable(wave, mipLevel);
+    // the mip sizes are powers of two, the index is the upper log2(size) bits of the phase
+    mipShift = 32;
+    for(int size = WaveTables::mipSize(mipLevel); size > 1; size >>= 1) {
+        mipShift--;
+    }
+    mipFractionScale = 1.0 / (double) (1u << mipShift);
 }
 
 float WaveGen::getFrequency() {
@@ -212,7 +225,7 @@ float WaveGen::getAmplitude() {
 }
 
 float WaveGen::getPhase() {
-    return phi;
+    return radians();
 }
 
 void WaveGen::setFrequency(float f) {
@@ -230,12 +243,21 @@ void WaveGen::setAmplitude(float a) {
 }
 
 void WaveGen::setPhase(float p) {
-    phi = p;
+    double f = fmod((double) p / TWO_PI, 1.0);
+    if(f < 0.0) {
+        f += 1.0;
+    }
+    phase = (uint32_t) (int64_t) (f * phaseRange);
 }
 void WaveGen::setType(TYPE type)  {
     _type = type;
+    selectMipTable();
+}
+void WaveGen::setSampleRate(int fS) {
+    fs = fS;
+    updatePhi();
 }
 void WaveGen::reset() {
     freq = 0.0;
-    phi = 0.0;
+    phase = 0;
 }
\ No newline at end of file
@@ -0,0 +1,76 @@
+/**
+ * \struct WaveTables
+ *
+ *
+ * \brief Read-only look-up tables shared by all WaveGen objects.
+ *
+ * The tables used to be members of every WaveGen, which made each Key
+ * carry roughly 40 KB of identical data. They are now stored exactly once,
+ * aligned to a cache line, and every oscillator only keeps its own phase state.
+ *
+ * For square, triangle, sawtooth and the custom wave there are also band-limited
+ * mip levels, one per octave. Level k holds at most maxHarmonics >> k harmonics,
+ * so an oscillator picks the first level whose highest harmonic stays below
+ * Nyquist (see mipLevel()) and reads it without any further anti-aliasing.
+ * The mip tables are calculated once on start-up from the Fourier series
+ * (custom wave: from the DFT of its 512-point table). The truncated series of
+ * square and sawtooth ring at the edges and peak at up to 4/pi, so all levels
+ * of a wave are scaled by one factor to stay within +-1 like the naive waves.
+ * One factor instead of one per level keeps the loudness constant when an
+ * oscillator switches levels. Lanczos sigma factors were not used, they would
+ * damp the few harmonics of the upper levels down to a quieter sine.
+ *
+ * \author $Author: Corvin Jaedicke & Alberto Monciero $
+ *
+ * \version $Revision: 1.5 $
+ *
+ * \date $Date: 2017/29/04 17:55:00 $
+ *
+ * Contact: c.jaedicke@math.tu-berlin.de
+ *
+ */
+
+#pragma once
+
+struct WaveTables
+{
+    static const int size = 512; ///< Size of look-up tables (one extra guard point is stored for interpolation)
+    static const int cacheLineSize = 64; ///< Alignment of every table in bytes
+
+    alignas(cacheLineSize) static const float sine[size+1]; ///< The sine LUT
+    alignas(cacheLineSize) static const float customWave[size+1]; ///< The custom-wave LUT
+    alignas(cacheLineSize) static const float saw[size+1]; ///< The sawtooth LUT
+    alignas(cacheLineSize) static const float tri[size+1]; ///< The triangle LUT
+
+    /// Waves with band-limited mip levels
+    enum MipWave {
+        MIP_SQUARE = 0,
+        MIP_TRIANGLE,
+        MIP_SAWTOOTH,
+        MIP_CUSTOM,
+        numMipWaves
+    };
+    static const int numMipLevels = 10; ///< One level per octave, the last one is a pure sine
+    static const int maxHarmonics = 512; ///< Harmonics of level 0
+    static const int minMipSize = 256; ///< Smallest table, keeps the interpolation error of the fundamental below -80 dB
+    static const int mipSizeTotal = 2048 + 1024 + 512 + 7 * minMipSize + numMipLevels; ///< All levels of one wave, with guard points
+
+    /**
+     * \brief Chooses the mip level for a phase increment.
+     * \param cyclesPerSample Frequency over sample rate
+     * \return Highest-resolution level without harmonics above Nyquist
+     */
+    static int mipLevel(float cyclesPerSample);
+    /// Number of samples of a mip level (one extra guard point is stored).
+    static int mipSize(int level) {return 4 * (maxHarmonics >> level) > minMipSize ? 4 * (maxHarmonics >> level) : minMipSize;}
+    /// First sample of a mip level.
+    static const float * mipTable(MipWave wave, int level) {return &mipTables[wave][mipOffset(level)];}
+
+private:
+    alignas(cacheLineSize) static float mipTables[numMipWaves][mipSizeTotal]; ///< All mip levels, level after level
+    /// Position of a mip level in mipTables.
+    static int mipOffset(int level);
+    /// Fills mipTables, called once on start-up.
+    static bool fillMipTables();
+    static bool mipTablesFilled; ///< Forces fillMipTables() during static initialization
+};
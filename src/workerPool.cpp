@@ -0,0 +1,98 @@
+#include "workerPool.h"
+
+#include <errno.h>
+#include <sched.h>
+
+namespace {
+
+void waitFor(sem_t * semaphore) {
+    while(sem_wait(semaphore) != 0 && errno == EINTR) {
+    }
+}
+
+}
+
+WorkerPool::WorkerPool(int numThreads, int rtPriority) :
+numThreads(numThreads < 1 ? 1 : (numThreads > maxThreads ? maxThreads : numThreads)),
+job(NULL),
+context(NULL),
+quit(false) {
+    sem_init(&done, 0, 0);
+    for(int i = 1; i < this->numThreads; i++) {
+        sem_init(&start[i], 0, 0);
+        arguments[i].pool = this;
+        arguments[i].worker = i;
+
+        pthread_attr_t attributes;
+        pthread_attr_init(&attributes);
+        // worker i runs on core i, core 0 is left to the thread calling run()
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(i, &cpus);
+        pthread_attr_setaffinity_np(&attributes, sizeof(cpus), &cpus);
+        if(rtPriority > 0) {
+            sched_param parameter;
+            parameter.sched_priority = rtPriority;
+            pthread_attr_setinheritsched(&attributes, PTHREAD_EXPLICIT_SCHED);
+            pthread_attr_setschedpolicy(&attributes, SCHED_FIFO);
+            pthread_attr_setschedparam(&attributes, &parameter);
+        }
+        if(pthread_create(&threads[i], &attributes, workerLoop, &arguments[i]) != 0) {
+            // no permission for realtime scheduling (or the core does not exist), try without
+            pthread_attr_destroy(&attributes);
+            pthread_attr_init(&attributes);
+            if(pthread_create(&threads[i], &attributes, workerLoop, &arguments[i]) != 0) {
+                sem_destroy(&start[i]);
+                this->numThreads = i;
+            }
+        }
+        pthread_attr_destroy(&attributes);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    quit.store(true);
+    for(int i = 1; i < numThreads; i++) {
+        sem_post(&start[i]);
+    }
+    for(int i = 1; i < numThreads; i++) {
+        pthread_join(threads[i], NULL);
+        sem_destroy(&start[i]);
+    }
+    sem_destroy(&done);
+}
+
+void WorkerPool::pinCaller() {
+    if(numThreads == 1)
+        return;
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(0, &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+}
+
+void WorkerPool::run(Job job, void * context) {
+    this->job = job;
+    this->context = context;
+    // sem_post/sem_wait order the memory accesses, workers see job and context
+    for(int i = 1; i < numThreads; i++) {
+        sem_post(&start[i]);
+    }
+    job(context, 0);
+    for(int i = 1; i < numThreads; i++) {
+        waitFor(&done);
+    }
+}
+
+void * WorkerPool::workerLoop(void * argument) {
+    threadArgument * a = (threadArgument *) argument;
+    WorkerPool * pool = a->pool;
+    while(true) {
+        waitFor(&pool->start[a->worker]);
+        if(pool->quit.load())
+            break;
+        pool->job(pool->context, a->worker);
+        sem_post(&pool->done);
+    }
+    return NULL;
+}
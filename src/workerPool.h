@@ -0,0 +1,93 @@
+/**
+ * \class WorkerPool
+ *
+ *
+ * \brief Realtime thread pool that runs one job on several cores and waits for all of them.
+ *
+ * All threads are started in the constructor, pinned to their own core and, if a
+ * priority is given, switched to SCHED_FIFO. run() only posts semaphores and waits
+ * for them, it never allocates and never takes a lock, so it may be called from the
+ * JACK process thread. The calling thread always does the share of worker 0,
+ * so a pool with one thread starts no thread at all.
+ *
+ * Worker i runs on core i, core 0 is left for the thread calling run(). A realtime
+ * caller should be pinned there once with pinCaller(), otherwise it may share a core
+ * with a worker of the same priority and that worker only starts after the caller
+ * waits for it. Offline tools may leave the caller unpinned.
+ *
+ * \author $Author: Corvin Jaedicke & Alberto Monciero $
+ *
+ * \version $Revision: 1.5 $
+ *
+ * \date $Date: 2017/29/04 21:14:27 $
+ *
+ * Contact: c.jaedicke@math.tu-berlin.de
+ *
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <atomic>
+
+class WorkerPool
+{
+public:
+    /// Work of one thread: context given to run() and number of the worker (0..getNumThreads()-1)
+    typedef void (*Job)(void * context, int worker);
+
+    static const int maxThreads = 4; ///< One thread per core of the RPi3
+
+    /**
+     * \brief Starts the worker threads.
+     * \param numThreads Threads including the calling thread, limited to 1..maxThreads
+     * \param rtPriority SCHED_FIFO priority of the workers, 0 for normal scheduling
+     *
+     * Falls back to normal scheduling if realtime priority is not permitted.
+     */
+    WorkerPool(int numThreads = 1, int rtPriority = 0);
+    /// Stops and joins all worker threads.
+    ~WorkerPool();
+
+    /**
+     * \brief Runs job on all threads and returns when every thread has finished.
+     * \param job Function called once per worker
+     * \param context Passed to job
+     */
+    void run(Job job, void * context);
+
+    /**
+     * \brief Pins the calling thread to core 0, the core no worker uses.
+     *
+     * Makes a syscall, call it once while setting up the thread that calls run()
+     * (e.g. from the JACK thread-init callback), never from run() itself.
+     * Does nothing for a pool with one thread.
+     */
+    void pinCaller();
+
+    /// Number of threads taking part in run(), including the calling thread.
+    int getNumThreads() const {return numThreads;}
+
+private:
+    int numThreads; ///< Threads taking part in run()
+    pthread_t threads[maxThreads]; ///< Worker threads, index 0 is unused (calling thread)
+    sem_t start[maxThreads]; ///< Posted by run() to wake one worker
+    sem_t done; ///< Posted by every worker when its job is finished
+    Job job; ///< Current job, only written while all workers wait
+    void * context; ///< Context of the current job
+    std::atomic<bool> quit; ///< Set by the destructor
+
+    /// Argument of the thread function
+    typedef struct {
+        WorkerPool * pool;
+        int worker;
+    }threadArgument;
+    threadArgument arguments[maxThreads]; ///< Arguments of the worker threads
+
+    /// Thread function: waits for start, runs the job, posts done.
+    static void * workerLoop(void * argument);
+
+    WorkerPool(const WorkerPool&);
+    WorkerPool& operator=(const WorkerPool&);
+};
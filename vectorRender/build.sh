@@ -0,0 +1,14 @@
+#!/bin/sh
+
+## enable NEON on the RPi3 with a 32 bit image, AArch64 always has it
+case $(uname -m) in
+    armv7l) ARCH_FLAGS="-mcpu=cortex-a53 -mfpu=neon-fp-armv8 -mfloat-abi=hard" ;;
+esac
+
+## RT_CHECK=1 sh build.sh: report allocations and locks on the audio threads (see src/realtimeCheck.h)
+if [ -n "$RT_CHECK" ]; then
+    ARCH_FLAGS="$ARCH_FLAGS -DVECTORSYNTH_RT_CHECK -g -rdynamic"
+    RT_LIBS="-ldl"
+fi
+
+g++ -O3 -std=c++11 -pthread $ARCH_FLAGS vectorRender.cpp ../src/filter.cpp ../src/moogLadderFilter.cpp ../src/saturation.cpp ../src/oversampler.cpp ../src/parameterSmoother.cpp ../src/patch.cpp ../src/midiFileReader.cpp ../src/waveGen.cpp ../src/waveTables.cpp ../src/key.cpp ../src/envelope.cpp ../src/midi2KeyHandler.cpp ../src/workerPool.cpp ../src/voicePool.cpp ../src/realtimeCheck.cpp -lsndfile $RT_LIBS -o vectorRender
@@ -0,0 +1,155 @@
+/**
+ * \file vectorRender.cpp
+ *
+ *
+ * \brief Renders a MIDI file with the VectorSynth engine into a WAV file, as fast as possible.
+ *
+ * Drives the Midi2KeyHandler directly, without JACK, RtMidi or any audio hardware.
+ * Useful for batch rendering and for profiling on any machine.
+ *
+ * Usage: vectorRender [-r samplerate] [-b buffersize] [-t tail] [-j threads] [-s saturation] [-o oversampling] input.mid|input.txt output.wav
+ *
+ * Inputs ending in .mid or .midi are read as Standard MIDI File,
+ * everything else as event script (see MidiFileReader).
+ * Built with RT_CHECK=1 every allocation or lock inside the render path is reported
+ * (see RealtimeCheck) and the exit code is 2 if there was any.
+ *
+ * \author $Author: Corvin Jaedicke & Alberto Monciero $
+ *
+ * \version $Revision: 1.5 $
+ *
+ * \date $Date: 2017/29/04 21:14:27 $
+ *
+ * Contact: c.jaedicke@math.tu-berlin.de
+ *
+ */
+
+#include <iostream>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <sndfile.h>
+
+#include "../src/midi2KeyHandler.h"
+#include "../src/midiFileReader.h"
+#include "../src/realtimeCheck.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+static void usage() {
+    cerr << "usage: vectorRender [-r samplerate] [-b buffersize] [-t tail] [-j threads] [-s saturation] [-o oversampling] input.mid|input.txt output.wav" << endl;
+    cerr << "  -r  sample rate in Hz (default 48000)" << endl;
+    cerr << "  -b  buffer size in frames, like the JACK period (default 256)" << endl;
+    cerr << "  -t  seconds rendered after the last event (default 2)" << endl;
+    cerr << "  -j  cores rendering voices (default 1)" << endl;
+    cerr << "  -s  filter saturation: libm, table, pade or bypass (default pade)" << endl;
+    cerr << "  -o  filter oversampling: 1, 2 or 4 (default 1)" << endl;
+}
+
+static bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+int main(int argc, char *argv[]) {
+    int sampleRate = 48000;
+    int bufferSize = 256;
+    double tail = 2.0;
+    int numThreads = 1;
+    int saturation = Saturation::SATURATION_PADE;
+    int oversampling = 1;
+
+    int opt;
+    while((opt = getopt(argc, argv, "r:b:t:j:s:o:h")) != -1) {
+        switch(opt) {
+            case 'r': sampleRate = atoi(optarg); break;
+            case 'b': bufferSize = atoi(optarg); break;
+            case 't': tail = atof(optarg); break;
+            case 'j': numThreads = atoi(optarg); break;
+            case 's':
+                for(saturation = 0; saturation < Saturation::numModes; saturation++) {
+                    if(std::string(optarg) == Saturation::name((Saturation::Mode) saturation))
+                        break;
+                }
+                break;
+            case 'o': oversampling = atoi(optarg); break;
+            default: usage(); return 1;
+        }
+    }
+    if(argc - optind != 2 || sampleRate <= 0 || bufferSize <= 0 || tail < 0 || numThreads <= 0 || saturation >= Saturation::numModes
+       || (oversampling != 1 && oversampling != 2 && oversampling != 4)) {
+        usage();
+        return 1;
+    }
+    std::string inputPath = argv[optind];
+    std::string outputPath = argv[optind + 1];
+
+    /// read events
+    MidiFileReader reader;
+    bool loaded = (endsWith(inputPath, ".mid") || endsWith(inputPath, ".midi"))
+        ? reader.loadMidiFile(inputPath)
+        : reader.loadScript(inputPath);
+    if(!loaded) {
+        cerr << "vectorRender: " << reader.getError() << endl;
+        return 1;
+    }
+    const std::vector<MidiFileReader::timedMessage>& events = reader.getEvents();
+
+    /// open output
+    SF_INFO info;
+    info.samplerate = sampleRate;
+    info.channels = 1;
+    info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+    SNDFILE *outFile = sf_open(outputPath.c_str(), SFM_WRITE, &info);
+    if(outFile == NULL) {
+        cerr << "vectorRender: " << sf_strerror(NULL) << endl;
+        return 1;
+    }
+
+    Midi2KeyHandler *keyHandler = new Midi2KeyHandler(sampleRate, numThreads);
+    keyHandler->setSaturation((Saturation::Mode) saturation);
+    keyHandler->setOversampling(oversampling);
+    std::vector<float> buffer(bufferSize);
+    std::vector<midiMessage> messages;
+    messages.reserve(events.size());
+
+    double lastEvent = events.empty() ? 0.0 : events.back().seconds;
+    long long totalFrames = (long long) ((lastEvent + tail) * sampleRate) + 1;
+    size_t nextEvent = 0;
+    double renderSeconds = 0.0;
+
+    /// render period by period, like the JACK callback does
+    for(long long frame = 0; frame < totalFrames; frame += bufferSize) {
+        int frames = totalFrames - frame < bufferSize ? totalFrames - frame : bufferSize;
+        messages.clear();
+        while(nextEvent < events.size()) {
+            long long eventFrame = (long long) (events[nextEvent].seconds * sampleRate);
+            if(eventFrame >= frame + frames)
+                break;
+            midiMessage m = events[nextEvent].message;
+            m.time = eventFrame > frame ? eventFrame - frame : 0;
+            messages.push_back(m);
+            nextEvent++;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        keyHandler->getNextSampleBuffer(&buffer[0], frames, messages.empty() ? NULL : &messages[0], messages.size());
+        renderSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        sf_writef_float(outFile, &buffer[0], frames);
+    }
+    sf_close(outFile);
+    delete keyHandler;
+
+    double audioSeconds = (double) totalFrames / sampleRate;
+    cout << "rendered " << audioSeconds << " s of audio in " << renderSeconds << " s ("
+         << audioSeconds / renderSeconds << "x realtime), " << events.size() << " events" << endl;
+    if(RealtimeCheck::getViolations() > 0) {
+        cerr << "vectorRender: " << RealtimeCheck::getViolations() << " allocations or locks in the realtime path" << endl;
+        return 2;
+    }
+    return 0;
+}
@@ -14,6 +14,9 @@ sudo ifconfig wlan0 down
 
 ## Focusrite:
  jackd -P80 -p16 -t2000 -dalsa -d hw:USB -p256 -n3 -r48000 -s &
+## for vectorSynth -m jack add -Xseq (exposes the ALSA MIDI devices as JACK MIDI ports)
+## and connect the keyboard to vectorSynth:midi_in, e.g. with jack_connect
+# jackd -P80 -p16 -t2000 -dalsa -d hw:USB -p256 -n3 -r48000 -s -Xseq &
 
 ## Renkforce:
 # jackd -P80 -p16 -t2000 -dalsa -d hw:Device -p128 -n3 -r48000 -s &
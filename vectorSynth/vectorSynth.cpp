@@ -20,10 +20,13 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <cmath>
+#include <string>
 #include <jackaudioio.hpp>
+#include <jack/jack.h>
 
 #include "../src/midiman.h"
 #include "../src/midi2KeyHandler.h"
+#include "../src/realtimeCheck.h"
 
 using std::cout;
 using std::endl;
@@ -36,45 +39,57 @@ private:
 
     MidiMan *midiMan;
     Midi2KeyHandler *keyHandler;
+    jack_port_t *midiInPort; ///< JACK MIDI input, events are applied at their frame offset, NULL with RtMidi
 
 public:
     /// Audio Callback Function:
     /// - the output buffers are filled here
+    /// - no allocation, no locks, no syscalls besides waking the workers (see RealtimeCheck)
     virtual int audioCallback(jack_nframes_t nframes,
                               // A vector of pointers to each input port.
                               audioBufVector inBufs,
                               // A vector of pointers to each output port.
                               audioBufVector outBufs){
-
-        while(processMIDI()) {}
-        keyHandler->getNextSampleBuffer(outBufs[0], nframes);
+        RealtimeCheck::Scope realtime;
+
+        /// follow sample rate changes of the JACK server
+        if(getSampleRate() != (jack_nframes_t) keyHandler->getSampleRate())
+            keyHandler->setSampleRate(getSampleRate());
+        /// collect the MIDI messages of this period, from RtMidi or the JACK MIDI port
+        midiMan->updateMidiMessages(midiInPort != NULL ? jack_port_get_buffer(midiInPort, nframes) : NULL);
+        keyHandler->getNextSampleBuffer(outBufs[0], nframes,
+                                        midiMan->getMidiMessages(),
+                                        midiMan->getNumMidiMessages());
         // return 0 on success
         return 0;
     }
 
     /// Constructor
-    VectorSynth() :
-        JackCpp::AudioIO("vectorSynth", 0,1){
+    /// \param jackMidi Receive MIDI through the JACK MIDI port instead of RtMidi,
+    /// only one of both is opened so no event is applied twice
+    VectorSynth(bool jackMidi) :
+        JackCpp::AudioIO("vectorSynth", 0,1),
+        midiInPort(NULL){
         //reserveInPorts(2);
         reserveOutPorts(2);
         /// allocate a new midi manager
-        midiMan = new MidiMan();
-        keyHandler = new Midi2KeyHandler();
+        midiMan = new MidiMan(!jackMidi);
+        /// render the voices on all four cores, workers get the priority of the JACK thread
+        keyHandler = new Midi2KeyHandler(getSampleRate(), 4, jack_client_real_time_priority(client()));
+        /// adapt the polyphony to the CPU, keep 30% of the period as headroom
+        keyHandler->setLoadGovernor(true, 0.7);
+        /// keep the JACK thread off the cores of the render workers, set up before start()
+        jack_set_thread_init_callback(client(), &VectorSynth::threadInit, this);
+        /// MIDI input port for sample-accurate timing, connected by the user (e.g. jack_connect)
+        if(jackMidi)
+            midiInPort = jack_port_register(client(), "midi_in", JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
         // debug on
         //midiMan->setVerbose();
     }
 
-    bool processMIDI() {
-        /// process midi messages
-        MidiMan::midiMessage val = midiMan->get_rtmidi();
-
-        if(val.hasBeenProcessed)
-        {
-            keyHandler->mapMidi(val);
-            // flush all messages
-            midiMan->flushProcessedMessages();
-        }
-        return val.hasBeenProcessed;
+    /// Runs once in the JACK process thread before its first callback.
+    static void threadInit(void * argument) {
+        static_cast<VectorSynth *>(argument)->keyHandler->pinAudioThread();
     }
 
 };
@@ -84,8 +99,20 @@ public:
 ///
 int main(int argc, char *argv[]){
 
+    /// -m jack: MIDI through the JACK MIDI port, default is RtMidi
+    bool jackMidi = false;
+    int opt;
+    while((opt = getopt(argc, argv, "m:h")) != -1) {
+        if(opt == 'm' && std::string(optarg) == "jack")
+            jackMidi = true;
+        else if(opt != 'm' || std::string(optarg) != "rtmidi") {
+            std::cerr << "usage: vectorSynth [-m rtmidi|jack]" << endl;
+            return 1;
+        }
+    }
+
     /// initial ports from constructor created here.
-    VectorSynth * t = new VectorSynth();
+    VectorSynth * t = new VectorSynth(jackMidi);
 
 
     /// activate the client